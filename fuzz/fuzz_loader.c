@@ -0,0 +1,454 @@
+/**
+ * Author(s):           Arda T. Kersu
+ * File name:           fuzz_loader.c
+ * Date:                1st November 2023
+ *
+ * Description: Differential fuzz target for the loaders of the library "open_csv.h". Every input is
+ *              written to a temporary file and parsed by a deliberately simple reference parser
+ *              ('fgets()', 'strtok_r()' and 'strtod()', row by row) and by every loader path of the
+ *              library; the frames must be identical bit for bit, NaN matching NaN. Paths checked:
+ *
+ *                  - loadCsvWith() with the fast CSV_FLOAT converters
+ *                  - loadCsvWith() with CSV_INT converters, against 'strtoll()'
+ *                  - loadCsvWith() with a Bernoulli sample of fraction 1, which keeps every row
+ *                  - csvLoadIndexed(), structural index then column by column conversion
+ *                  - csvOpenLazy() and csvColumn(), columns converted on first access, last first
+ *                  - csvHead(), csvTail() and csvRange(), against the matching rows of the reference
+ *                  - csvCompact() of a sorted group-by result and of a sorted, deduplicated frame, whose
+ *                    blocks must then hold the rows in their new order
+ *
+ *              Once per run, a fixed file checks that rows dropped by streaming deduplication leave
+ *              the distinct count estimates untouched.
+ *                  - csvSaveNpy() then csvLoadNpy(), which memory maps the file where possible
+ *
+ *              Any difference aborts, so libFuzzer and AFL report it as a crash. Build with libFuzzer:
+ *
+ *                  clang -g -O1 -fsanitize=fuzzer,address,undefined fuzz/fuzz_loader.c open_csv.c \
+ *                        -o fuzz_loader -lm
+ *                  ./fuzz_loader fuzz/corpus
+ *
+ *              or define CSV_FUZZ_MAIN to get a 'main()' that runs every file named on the command
+ *              line, for AFL ('afl-fuzz -i fuzz/corpus -o findings -- ./fuzz_loader @@') or to replay
+ *              a corpus under any compiler.
+ *
+ *              The loader reads lines with a 1024 byte buffer and stops at NUL bytes, so inputs with
+ *              longer lines or with NUL bytes are skipped rather than compared.
+ *
+ * Disclaimer: This open-source project is provided "as is" without any warranty, expressed or implied.
+ *             The contributors and maintainers disclaim any an all unintended consequences or issues
+ *             that may arise from its use. Users are encouraged to review and understand the software's
+ *             characteristics before implementation.
+ *
+ *
+ * Copyright @ [Arda T. Kersu]
+ *
+ */
+
+#define _POSIX_C_SOURCE 200809L //mkstemp(), strtok_r()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "../open_csv.h"
+
+typedef struct {
+    int rows;
+    int cols;
+    float *values;      //rows * cols, row-major
+}refFrame_t;
+
+/**
+ * @brief Parse a file the plain way: one 'fgets()' per line, 'strtok_r()' on the delimiters.
+ *
+ * Mirrors the documented behaviour of the loader: the first line holds the feature names, the first
+ * data line sets the number of columns, extra fields are ignored and missing ones are NaN.
+ */
+static int refParse(const char *path, int asInt, refFrame_t *ref)
+{
+    char line[1024];
+    char *save;
+    FILE *file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        return 0;
+    }
+
+    ref->rows = 0;
+    ref->cols = -1;
+    ref->values = NULL;
+    if(fgets(line, sizeof(line), file) == NULL) //no header, no data
+    {
+        ref->cols = 0;
+    }
+
+    while(fgets(line, sizeof(line), file))
+    {
+        if(ref->cols < 0)
+        {
+            ref->cols = 0;
+            char copy[1024];
+            memcpy(copy, line, sizeof(copy));
+            for(char *token = strtok_r(copy, CSV_DELIM, &save); token; token = strtok_r(NULL, CSV_DELIM, &save))
+            {
+                ref->cols++;
+            }
+        }
+
+        float *grown = (float *)realloc(ref->values, sizeof(float) * ((size_t)(ref->rows + 1) * ref->cols + 1));
+        if(grown == NULL)
+        {
+            abort();
+        }
+        ref->values = grown;
+
+        float *row = ref->values + (size_t)ref->rows * ref->cols;
+        int col = 0;
+        for(char *token = strtok_r(line, CSV_DELIM, &save); token && col < ref->cols; token = strtok_r(NULL, CSV_DELIM, &save))
+        {
+            row[col++] = asInt ? (float)strtoll(token, NULL, 10) : (float)strtod(token, NULL);
+        }
+        while(col < ref->cols)
+        {
+            row[col++] = NAN;
+        }
+        ref->rows++;
+    }
+    if(ref->cols < 0)
+    {
+        ref->cols = 0;
+    }
+
+    fclose(file);
+    return 1;
+}
+
+static int sameValue(float a, float b)
+{
+    return (isnan(a) && isnan(b)) || memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+/**
+ * @brief Check that 'df' holds the 'count' reference rows starting at 'first'.
+ */
+static void expectRows(const refFrame_t *ref, int first, int count, const csvData_t *df, const char *variant)
+{
+    if(df == NULL || df->rows != count || (count > 0 && df->cols != ref->cols))
+    {
+        fprintf(stderr, "%s: frame is %dx%d, reference is %dx%d\n", variant,
+                df != NULL ? df->rows : -1, df != NULL ? df->cols : -1, count, ref->cols);
+        abort();
+    }
+
+    for(int row=0; row<count; row++)
+    {
+        for(int col=0; col<ref->cols; col++)
+        {
+            float want = ref->values[(size_t)(first + row) * ref->cols + col];
+            if( ! sameValue(df->dataFrame[row][col], want))
+            {
+                fprintf(stderr, "%s: [%d][%d] is %.9g, reference is %.9g\n", variant, row, col,
+                        df->dataFrame[row][col], want);
+                abort();
+            }
+        }
+    }
+}
+
+static void expectFrame(const refFrame_t *ref, const csvData_t *df, const char *variant)
+{
+    expectRows(ref, 0, ref->rows, df, variant);
+}
+
+static void expectLazy(const refFrame_t *ref, csvLazy_t *lazy, const char *variant)
+{
+    if(lazy == NULL || lazy->rows != ref->rows || (ref->rows > 0 && lazy->cols != ref->cols))
+    {
+        fprintf(stderr, "%s: frame is %dx%d, reference is %dx%d\n", variant,
+                lazy != NULL ? lazy->rows : -1, lazy != NULL ? lazy->cols : -1, ref->rows, ref->cols);
+        abort();
+    }
+
+    for(int col=ref->rows > 0 ? ref->cols - 1 : -1; col>=0; col--)
+    {
+        const float *values = csvColumn(lazy, col);
+        if(values == NULL || csvColumn(lazy, col) != values) //the second access must hit the cache
+        {
+            fprintf(stderr, "%s: column %d was not cached\n", variant, col);
+            abort();
+        }
+        for(int row=0; row<ref->rows; row++)
+        {
+            float want = ref->values[(size_t)row * ref->cols + col];
+            if( ! sameValue(values[row], want))
+            {
+                fprintf(stderr, "%s: [%d][%d] is %.9g, reference is %.9g\n", variant, row, col, values[row], want);
+                abort();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compact a frame whose row table may have been reordered, and check its block row by row.
+ */
+static void expectCompact(csvData_t *df, const char *variant)
+{
+    if(df == NULL)
+    {
+        return;
+    }
+
+    size_t cols = (size_t)df->cols;
+    float *before = (float *)malloc(sizeof(float) * ((size_t)df->rows * cols + 1));
+    if(before == NULL)
+    {
+        abort();
+    }
+    for(int row=0; row<df->rows; row++)
+    {
+        memcpy(before + row * cols, df->dataFrame[row], sizeof(float) * cols);
+    }
+
+    if(csvCompact(df) != TRUE)
+    {
+        fprintf(stderr, "%s: compaction failed\n", variant);
+        abort();
+    }
+    for(int row=0; row<df->rows; row++)
+    {
+        if(df->dataFrame[row] != df->block + row * cols ||
+           memcmp(df->block + row * cols, before + row * cols, sizeof(float) * cols) != 0)
+        {
+            fprintf(stderr, "%s: row %d is not in block order after compaction\n", variant, row);
+            abort();
+        }
+    }
+
+    free(before);
+}
+
+/**
+ * @brief Load 1000 rows sharing column 0 with deduplication on it: one row is kept, and the distinct
+ *        count of column 1 must describe that row rather than every row read.
+ */
+static void checkDedupDistinct(void)
+{
+    char path[] = "/tmp/open_csv_dedup_XXXXXX";
+    int fd = mkstemp(path);
+    FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+
+    if(file == NULL)
+    {
+        return;
+    }
+    fputs("key, value\n", file);
+    for(int row=0; row<1000; row++)
+    {
+        fprintf(file, "7, %d\n", row);
+    }
+    fclose(file);
+
+    int key = 0;
+    csvLoadOpts_t opts = {0};
+    opts.path = path;
+    opts.dedupCols = &key;
+    opts.nDedupCols = 1;
+    opts.dedupCapacity = 16;
+    opts.distinctCounts = TRUE;
+
+    csvData_t *df = loadCsvWith(NULL, &opts);
+    double distinct = csvDistinctCount(df, 1);
+    if(df == NULL || df->rows != 1 || distinct > 1.5)
+    {
+        fprintf(stderr, "dedup distinct counts: %d rows kept, %.1f distinct values estimated\n",
+                df != NULL ? df->rows : -1, distinct);
+        abort();
+    }
+
+    freeDataFrame(df);
+    unlink(path);
+}
+
+static int comparable(const uint8_t *data, size_t size)
+{
+    size_t lineLength = 0;
+
+    for(size_t at=0; at<size; at++)
+    {
+        if(data[at] == '\0' || ++lineLength >= 1023)
+        {
+            return 0;
+        }
+        if(data[at] == '\n')
+        {
+            lineLength = 0;
+        }
+    }
+
+    return 1;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    char path[] = "/tmp/open_csv_fuzz_XXXXXX";
+    char npyPath[sizeof(path) + 4];
+    refFrame_t ref, refInt;
+    static int checked = 0;
+
+    if( ! checked)
+    {
+        checked = 1;
+        checkDedupDistinct();
+    }
+    if( ! comparable(data, size))
+    {
+        return 0;
+    }
+
+    int fd = mkstemp(path);
+    if(fd < 0)
+    {
+        return 0;
+    }
+    if(write(fd, data, size) != (ssize_t)size)
+    {
+        close(fd);
+        unlink(path);
+        return 0;
+    }
+    close(fd);
+    snprintf(npyPath, sizeof(npyPath), "%s.npy", path);
+
+    if(refParse(path, 0, &ref) && refParse(path, 1, &refInt))
+    {
+        csvLoadOpts_t opts = {0};
+        opts.path = path;
+
+        csvData_t *df = loadCsvWith(NULL, &opts);
+        expectFrame(&ref, df, "fast converters");
+
+        if(df != NULL && csvSaveNpy(df, npyPath) == TRUE)
+        {
+            csvData_t *npy = csvLoadNpy(npyPath);
+            expectFrame(&ref, npy, "npy round trip");
+            freeDataFrame(npy);
+            unlink(npyPath);
+        }
+        freeDataFrame(df);
+
+        opts.sampleMode = CSV_SAMPLE_BERNOULLI;
+        opts.sampleFraction = 1.0;
+        df = loadCsvWith(NULL, &opts);
+        expectFrame(&ref, df, "bernoulli sample of every row");
+        freeDataFrame(df);
+
+        csvType_t *types = (csvType_t *)malloc(sizeof(csvType_t) * (refInt.cols + 1));
+        for(int col=0; types != NULL && col<refInt.cols; col++)
+        {
+            types[col] = CSV_INT;
+        }
+        opts.sampleMode = CSV_SAMPLE_NONE;
+        opts.colTypes = types;
+        df = loadCsvWith(NULL, &opts);
+        expectFrame(&refInt, df, "int converters");
+        freeDataFrame(df);
+
+        df = csvLoadIndexed(&opts);
+        expectFrame(&refInt, df, "indexed int converters");
+        freeDataFrame(df);
+
+        csvLazy_t *lazy = csvOpenLazy(&opts);
+        expectLazy(&refInt, lazy, "lazy int converters");
+        csvCloseLazy(lazy);
+
+        opts.colTypes = NULL;
+        df = csvLoadIndexed(&opts);
+        expectFrame(&ref, df, "indexed");
+        freeDataFrame(df);
+
+        lazy = csvOpenLazy(&opts);
+        expectLazy(&ref, lazy, "lazy");
+        csvCloseLazy(lazy);
+
+        int n = (int)(size % 7), skip = (int)(size % 5); //range sizes derived from the input
+        int head = n < ref.rows ? n : ref.rows;
+        int ranged = skip >= ref.rows ? 0 : (ref.rows - skip < n ? ref.rows - skip : n);
+
+        df = csvHead(path, n);
+        expectRows(&ref, 0, head, df, "head");
+        freeDataFrame(df);
+
+        df = csvTail(path, n);
+        expectRows(&ref, ref.rows - head, head, df, "tail");
+        freeDataFrame(df);
+
+        df = csvRange(path, skip, n);
+        expectRows(&ref, skip < ref.rows ? skip : ref.rows, ranged, df, "range");
+        freeDataFrame(df);
+
+        if(ref.rows > 0 && ref.cols > 0) //frames built with a block, then reordered
+        {
+            int key = 0;
+            csvOrder_t descending = CSV_DESCENDING;
+            csvAgg_t count = {0, CSV_COUNT};
+
+            df = csvLoadIndexed(&opts);
+            csvData_t *groups = csvGroupBy(df, &key, 1, &count, 1);
+            csvSortBy(groups, &key, &descending, 1);
+            expectCompact(groups, "sorted group-by compaction");
+            freeDataFrame(groups);
+
+            csvSortBy(df, &key, &descending, 1);
+            csvDedup(df, &key, 1, NULL);
+            expectCompact(df, "sorted and deduplicated compaction");
+            freeDataFrame(df);
+        }
+        free(types);
+
+        free(ref.values);
+        free(refInt.values);
+    }
+
+    unlink(path);
+    return 0;
+}
+
+#ifdef CSV_FUZZ_MAIN
+int main(int argc, char **argv)
+{
+    for(int arg=1; arg<argc; arg++)
+    {
+        FILE *file = fopen(argv[arg], "rb");
+        if(file == NULL)
+        {
+            continue;
+        }
+
+        uint8_t *data = NULL;
+        size_t size = 0, capacity = 0, got;
+        do
+        {
+            if(size == capacity)
+            {
+                capacity = capacity ? capacity * 2 : 4096;
+                data = (uint8_t *)realloc(data, capacity);
+                if(data == NULL)
+                {
+                    abort();
+                }
+            }
+            got = fread(data + size, 1, capacity - size, file);
+            size += got;
+        } while(got > 0);
+        fclose(file);
+
+        LLVMFuzzerTestOneInput(data, size);
+        free(data);
+    }
+
+    return 0;
+}
+#endif
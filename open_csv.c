@@ -17,12 +17,50 @@
  *
  */
 
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200809L //mmap() under strict ISO C modes
+#endif
+#if defined(CSV_ENABLE_STATS) && defined(__linux__)
+#define _GNU_SOURCE //syscall() for perf_event_open()
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <time.h>
 #include "open_csv.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CSV_HAVE_MMAP
+#endif
+
+#ifdef CSV_ENABLE_STATS
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#define CSV_HAVE_PERF
+#endif
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && ! defined(__STDC_NO_ATOMICS__)
+#include <stdatomic.h>
+#define CSV_HAVE_ATOMICS
+#endif
+
+#if defined(CSV_ENABLE_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#include <pthread.h>
+#define CSV_HAVE_THREADS
+#define CSV_MAX_THREADS     (16)        //workers of one parallel step at most, the caller included
+#define CSV_PARALLEL_WORK   (1 << 16)   //rows or values per worker below which a step stays serial
+#endif
+
 FILE *csvPtr = NULL;
 
 
@@ -58,45 +96,50 @@ void closeFile(FILE *filePtr)
 }
 
 /**
- * @brief Get the size of a data frame from a '.csv' file.
- *
- * This function reads a '.csv' file pointed to by 'filePtr' and determines the number of rows and columns
- * in the data frame. It skips the first row (usually containing feature names) and counts the rows
- * and columns in the dataset.
- *
- * @param filePtr A pointer to the '.csv' file to analyze.
- * @return An integer array containing the number of rows and columns, or NULL if an error occurs.
+ * @brief Split the next token off a string, like 'strtok()' but keeping its position in 'save'.
  *
- * @note This function dynamically allocates memory for the integer array 'retVal,' which should be
- *       freed by the caller when no longer needed to avoid memory leaks.
+ * Runs of deliminator characters separate tokens and leading ones are skipped. Unlike 'strtok()', no
+ * state is shared between calls on different strings, so loads may run concurrently.
+ */
+static char *splitToken(char *str, const char *delim, char **save)
+{
+    char *token = str != NULL ? str : *save;
+
+    token += strspn(token, delim);
+    if(*token == '\0')
+    {
+        *save = token;
+        return NULL;
+    }
+
+    char *end = token + strcspn(token, delim);
+    if(*end != '\0')
+    {
+        *end++ = '\0';
+    }
+    *save = end;
+
+    return token;
+}
+
+/**
+ * @brief Count the data rows of a '.csv' file and the columns of its first data row.
  *
- * @code
- *   // Example usage:
- *   FILE *file = fopen("data.csv", "r");
- *   int *size = getDFsize(file);
- *   if (size != NULL) {
- *       printf("Number of rows: %d\n", size[0]);
- *       printf("Number of columns: %d\n", size[1]);
- *       free(size); // Free the allocated memory
- *   }
- *   else
- *   {
- *       puts("Error occurred while getting data frame size.");
- *   }
- *   // Analyze the '.csv' file and retrieve the data frame size...
- * @endcode
+ * Shared by 'getDFsize()', which works on CSV_PATH, and the loaders that take a path. Returns FALSE
+ * if the file could not be opened.
  */
-int *getDFsize(FILE *filePtr)
+static bool_t sizeOfFile(const char *path, int *rows, int *cols)
 {
     char buffer[1024];      //buffer
+    char *save;
     int skipFirstRow = 0;   //skips the "feature names" row, first row of the file
-    int *retVal = (int *)malloc(sizeof(int) * 2), dfRows = 0, dfCols = 0; //return value
-    filePtr = fopen(CSV_PATH, CSV_MODE);    //open the file
+    int dfRows = 0, dfCols = 0;
+    FILE *filePtr = fopen(path, CSV_MODE);    //open the file
 
     if(filePtr == NULL) //check file validity
     {
         puts("Could not open the file.");
-        return NULL;
+        return FALSE;
     }
     else
     {
@@ -106,7 +149,7 @@ int *getDFsize(FILE *filePtr)
     bool_t lock = FALSE;
     while(fgets(buffer, 1024, filePtr)) //pull file contents row by row
     {
-        char *tokens = strtok(buffer, CSV_DELIM); //split them into tokens separated by deliminator
+        char *tokens = splitToken(buffer, CSV_DELIM, &save); //split them into tokens separated by deliminator
 
         if(skipFirstRow == 0) //this condition locks itself out once it has executed for the value 0
         {
@@ -118,7 +161,7 @@ int *getDFsize(FILE *filePtr)
         {
             while(tokens) //count tokens
             {
-                tokens = strtok(NULL, CSV_DELIM);
+                tokens = splitToken(NULL, CSV_DELIM, &save);
                 dfCols++;
             }
             lock = TRUE;
@@ -127,14 +170,59 @@ int *getDFsize(FILE *filePtr)
         dfRows++; //count rows
     }
 
-    retVal[0] = dfRows;
-    retVal[1] = dfCols;
+    *rows = dfRows;
+    *cols = dfCols;
 
     closeFile(filePtr);
 
+    return TRUE;
+}
+
+/**
+ * @brief Get the size of a data frame from a '.csv' file.
+ *
+ * This function reads a '.csv' file pointed to by 'filePtr' and determines the number of rows and columns
+ * in the data frame. It skips the first row (usually containing feature names) and counts the rows
+ * and columns in the dataset.
+ *
+ * @param filePtr A pointer to the '.csv' file to analyze.
+ * @return An integer array containing the number of rows and columns, or NULL if an error occurs.
+ *
+ * @note This function dynamically allocates memory for the integer array 'retVal,' which should be
+ *       freed by the caller when no longer needed to avoid memory leaks.
+ *
+ * @code
+ *   // Example usage:
+ *   FILE *file = fopen("data.csv", "r");
+ *   int *size = getDFsize(file);
+ *   if (size != NULL) {
+ *       printf("Number of rows: %d\n", size[0]);
+ *       printf("Number of columns: %d\n", size[1]);
+ *       free(size); // Free the allocated memory
+ *   }
+ *   else
+ *   {
+ *       puts("Error occurred while getting data frame size.");
+ *   }
+ *   // Analyze the '.csv' file and retrieve the data frame size...
+ * @endcode
+ */
+int *getDFsize(FILE *filePtr)
+{
+    int *retVal = (int *)malloc(sizeof(int) * 2); //return value
+
+    (void)filePtr; //the size is always taken from CSV_PATH
+    if(retVal == NULL || sizeOfFile(CSV_PATH, &retVal[0], &retVal[1]) != TRUE)
+    {
+        free(retVal);
+        return NULL;
+    }
+
     return retVal;
 }
 
+static csvData_t *frameForFile(const char *path);
+
 /**
  * @brief Create a CSV data frame structure based on file information.
  *
@@ -167,16 +255,49 @@ int *getDFsize(FILE *filePtr)
  */
 csvData_t *createDataFrame(FILE *filePtr)
 {
-    int *dfSize = getDFsize(filePtr); //get dataframe size info
+    (void)filePtr; //the frame is always sized from CSV_PATH
+    return frameForFile(CSV_PATH);
+}
+
+/**
+ * @brief Create an empty data frame sized after the '.csv' file at 'path', see 'createDataFrame()'.
+ */
+static csvData_t *frameForFile(const char *path)
+{
+    int rows, cols;
+    if(sizeOfFile(path, &rows, &cols) != TRUE) //get dataframe size info
+    {
+        return NULL;
+    }
+
     csvData_t *dataFrame = (csvData_t *)malloc(sizeof(csvData_t)); //allocate memory for row/column numbers
-    dataFrame->rows = dfSize[0];
-    dataFrame->cols = dfSize[1];
+    if(dataFrame == NULL)
+    {
+        return NULL;
+    }
+    dataFrame->rows = rows;
+    dataFrame->cols = cols;
 
-    dataFrame->delim = (char *)malloc(sizeof(char) * 2); //allocate memory for deliminator
-    strncpy(dataFrame->delim, CSV_DELIM, sizeof(char *));
+    dataFrame->delim = (char *)malloc(sizeof(char) * (strlen(CSV_DELIM) + 1)); //allocate memory for deliminator
+    dataFrame->params = (char *)malloc(sizeof(char) * 1024);//allocate memory for features, as long as one line
+    if(dataFrame->delim == NULL || dataFrame->params == NULL)
+    {
+        free(dataFrame->delim);
+        free(dataFrame->params);
+        free(dataFrame);
+        return NULL;
+    }
+    strcpy(dataFrame->delim, CSV_DELIM);
+    dataFrame->params[0] = '\0';
 
-    dataFrame->params = (char *)malloc(sizeof(char) * (dataFrame->cols + 1));//allocate memory for features
-    dataFrame->params[dataFrame->cols] = '\0';
+    dataFrame->dataFrame = NULL;
+    dataFrame->zoneMap = NULL;
+    dataFrame->block = NULL;
+    dataFrame->sketches = NULL;
+    dataFrame->hll = NULL;
+    dataFrame->parent = NULL;
+    dataFrame->mapping = NULL;
+    dataFrame->mappingSize = 0;
 
     return dataFrame;
 }
@@ -212,6 +333,10 @@ csvData_t *createDataFrame(FILE *filePtr)
 char *trimToken(char *token)
 {
     char *trimmedToken = (char *)malloc(strlen(token) + 1);
+    if(trimmedToken == NULL)
+    {
+        return NULL;
+    }
     trimmedToken[0] = '\0';
 
     int loop = 0, innerLoop = 0;
@@ -229,17 +354,96 @@ char *trimToken(char *token)
             loop++;
         }
     }
+    *(trimmedToken + innerLoop) = '\0';
 
     return trimmedToken;
 }
 
+/**
+ * @brief Allocate an empty zone map for 'df', replacing any existing one.
+ *
+ * Every block starts with min = +inf, max = -inf and no NaNs, so a block whose values are all NaN
+ * keeps min > max and never matches a range. Returns FALSE if memory could not be allocated.
+ */
+static bool_t zoneMapInit(csvData_t *df, int blockRows)
+{
+    if(df->zoneMap != NULL)
+    {
+        free(df->zoneMap->min);
+        free(df->zoneMap->max);
+        free(df->zoneMap->nullCount);
+        free(df->zoneMap);
+        df->zoneMap = NULL;
+    }
+
+    csvZoneMap_t *zm = (csvZoneMap_t *)malloc(sizeof(csvZoneMap_t));
+    if(zm == NULL)
+    {
+        return FALSE;
+    }
+
+    zm->blockRows = blockRows;
+    zm->blocks = (df->rows + blockRows - 1) / blockRows;
+    zm->cols = df->cols;
+
+    size_t cells = (size_t)zm->blocks * zm->cols;
+    zm->min = (float *)malloc(sizeof(float) * (cells + 1));
+    zm->max = (float *)malloc(sizeof(float) * (cells + 1));
+    zm->nullCount = (int *)calloc(cells + 1, sizeof(int));
+
+    if(zm->min == NULL || zm->max == NULL || zm->nullCount == NULL)
+    {
+        free(zm->min);
+        free(zm->max);
+        free(zm->nullCount);
+        free(zm);
+        return FALSE;
+    }
+
+    for(size_t cell=0; cell<cells; cell++)
+    {
+        zm->min[cell] = INFINITY;
+        zm->max[cell] = -INFINITY;
+    }
+
+    df->zoneMap = zm;
+
+    return TRUE;
+}
+
+/**
+ * @brief Fold one parsed row into the block statistics it belongs to.
+ */
+static void zoneMapUpdate(csvZoneMap_t *zm, int row, const float *values)
+{
+    if(zm == NULL)
+    {
+        return;
+    }
+
+    size_t base = (size_t)(row / zm->blockRows) * zm->cols;
+    for(int col=0; col<zm->cols; col++)
+    {
+        float value = values[col];
+        if(isnan(value))
+        {
+            zm->nullCount[base + col]++;
+            continue;
+        }
+        if(value < zm->min[base + col]) zm->min[base + col] = value;
+        if(value > zm->max[base + col]) zm->max[base + col] = value;
+    }
+}
+
 /**
  * @brief Load data from a '.csv' file into a CSV data frame.
  *
  * This function opens a '.csv' file pointed to by 'filePtr', reads the data from the file,
  * and loads it into a CSV data frame. It extracts feature names from the first row and stores
  * them in the data frame's 'params' member. Data points are read and stored in the 'dataFrame'
- * member of the data frame.
+ * member of the data frame. While the rows are parsed, the minimum, maximum and NaN count of every
+ * column are recorded for each block of CSV_ZONE_ROWS rows into the 'zoneMap' member, see
+ * 'csvZoneMayMatch()'.
  *
  * @param filePtr A pointer to the '.csv' file to load data from.
  * @return A pointer to a dynamically allocated 'csvData_t' structure representing the loaded data frame.
@@ -255,13 +459,7 @@ char *trimToken(char *token)
  *   {
  *       // Use the loaded data frame...
  *       // Don't forget to free the allocated memory when done.
- *       free(dataFrame->params);
- *       for (int row = 0; row < dataFrame->rows; row++)
- *       {
- *           free(dataFrame->dataFrame[row]);
- *       }
- *       free(dataFrame->dataFrame);
- *       free(dataFrame);
+ *       freeDataFrame(dataFrame);
  *   }
  *   else
  *   {
@@ -273,60 +471,5339 @@ char *trimToken(char *token)
 
 csvData_t *loadCsv(FILE *filePtr)
 {
-    char buffer[1024];
+    return loadCsvWith(filePtr, NULL);
+}
 
-    filePtr = fopen(CSV_PATH, CSV_MODE);
+/**
+ * @brief Tell whether every row of a frame is its own allocation, to be freed one by one.
+ */
+static int rowsOwned(const csvData_t *df)
+{
+    return df->block == NULL && df->parent == NULL && df->mapping == NULL;
+}
 
-    if(filePtr != NULL)
+/**
+ * @brief Release a CSV data frame and every buffer it owns.
+ *
+ * This function frees the feature names, the deliminator, every data row, the row table and the
+ * zone map of a data frame created by 'loadCsv()' or any other function of this library that returns
+ * a 'csvData_t'. Passing NULL is allowed and does nothing.
+ *
+ * @param df A pointer to the data frame to be released.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *dataFrame = loadCsv(NULL);
+ *   // Use the loaded data frame...
+ *   freeDataFrame(dataFrame);
+ * @endcode
+ */
+void freeDataFrame(csvData_t *df)
+{
+    if(df == NULL)
     {
-        puts("the file has been opened\n");
+        return;
     }
 
-    csvData_t *df = createDataFrame(filePtr); //create and initialize dataframe
-
-    //EXTRACT FEATURE NAMES ---------------------------------------------------
-
+    if(df->dataFrame != NULL)
+    {
+        for(int row=0; row<df->rows && rowsOwned(df); row++)
+        {
+            free(df->dataFrame[row]);
+        }
+        free(df->dataFrame);
+    }
+    free(df->block);
+    free(df->hll);
+#ifdef CSV_HAVE_MMAP
+    if(df->mapping != NULL)
     {
-        fgets(buffer, 1024, filePtr);       //get the first line of csv file
-        char *tokens = strtok(buffer, df->delim);   //split into multiple tokens
+        munmap(df->mapping, df->mappingSize);
+    }
+#endif
 
-        while(tokens) //
+    if(df->sketches != NULL)
+    {
+        for(int col=0; col<df->cols; col++)
         {
-            char *label = trimToken(tokens); //trim token of unwanted characters
-            strncat(df->params, label, sizeof(char) * strlen(label)); //write into dataframe
-            printf("\"%s\", \n", trimToken(tokens)); //print dataset features, can be commented out
-            tokens = strtok(NULL, df->delim); //split the next token from source
+            csvSketchFree(df->sketches[col]);
         }
+        free(df->sketches);
     }
 
-    //EXTRACT DATA POINTS------------------------------------------------------
+    if(df->zoneMap != NULL)
+    {
+        free(df->zoneMap->min);
+        free(df->zoneMap->max);
+        free(df->zoneMap->nullCount);
+        free(df->zoneMap);
+    }
 
-    df->dataFrame = (float **)malloc(sizeof(float *) * df->rows); //allocate ...
-    for(int row=0; row<df->rows; row++)                                //... memory
+    free(df->delim);
+    free(df->params);
+    free(df);
+}
+
+/**
+ * @brief Recompute the per block zone map of a data frame.
+ *
+ * The zone map stores the minimum, the maximum and the number of NaN values of every column for each
+ * run of 'blockRows' consecutive rows. 'loadCsv()' records it with CSV_ZONE_ROWS rows per block while
+ * parsing; call this function after the rows of a frame have been modified or reordered, or to choose
+ * a different block size.
+ *
+ * @param df A pointer to the data frame to summarise.
+ * @param blockRows The number of rows per block, must be positive.
+ * @return TRUE on success, ERROR if the arguments are invalid, FALSE if memory could not be allocated.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *dataFrame = loadCsv(NULL);
+ *   if (csvBuildZoneMap(dataFrame, 4096) == TRUE)
+ *   {
+ *       printf("%d blocks\n", dataFrame->zoneMap->blocks);
+ *   }
+ * @endcode
+ */
+bool_t csvBuildZoneMap(csvData_t *df, int blockRows)
+{
+    if(df == NULL || df->dataFrame == NULL || blockRows <= 0)
     {
-        df->dataFrame[row] = (float *)malloc(sizeof(float) * df->cols);
+        return ERROR;
     }
 
+    if(zoneMapInit(df, blockRows) != TRUE)
     {
-        int row = 0;
-        while(fgets(buffer, 1024, filePtr)) //get data from dataset row by row
-        {
-            int col = 0;
-            char *tokens = strtok(buffer, df->delim); //split into tokens
+        return FALSE;
+    }
 
-            while(tokens)
-            {
-                df->dataFrame[row][col] = atof(tokens); //feed data into dataframe
-                tokens = strtok(NULL, df->delim); //further break into tokens
-                col++;
-            }
-            //(void)puts(" ");
+    for(int row=0; row<df->rows; row++)
+    {
+        zoneMapUpdate(df->zoneMap, row, df->dataFrame[row]);
+    }
 
-            row++;
+    return TRUE;
+}
+
+/**
+ * @brief Check whether a block may hold values of a column inside a closed range.
+ *
+ * Range filters use this to skip whole blocks: when it returns FALSE, no row of 'block' has a value of
+ * 'col' in [lo, hi] and the block does not need to be touched. TRUE only means that the block has to
+ * be scanned. Frames without a zone map always return TRUE.
+ *
+ * @param df A pointer to the data frame.
+ * @param block The block index, between 0 and 'df->zoneMap->blocks' - 1.
+ * @param col The column index.
+ * @param lo The lower bound of the range.
+ * @param hi The upper bound of the range.
+ * @return TRUE if the block may match, FALSE if it certainly does not, ERROR on invalid arguments.
+ *
+ * @code
+ *   // Example usage:
+ *   csvZoneMap_t *zm = dataFrame->zoneMap;
+ *   for (int block = 0; block < zm->blocks; block++)
+ *   {
+ *       if (csvZoneMayMatch(dataFrame, block, 0, 10.0f, 20.0f) != TRUE)
+ *       {
+ *           continue; // nothing to see in these rows
+ *       }
+ *       int end = (block + 1) * zm->blockRows < dataFrame->rows ? (block + 1) * zm->blockRows : dataFrame->rows;
+ *       for (int row = block * zm->blockRows; row < end; row++)
+ *       {
+ *           // Filter row...
+ *       }
+ *   }
+ * @endcode
+ */
+bool_t csvZoneMayMatch(const csvData_t *df, int block, int col, float lo, float hi)
+{
+    if(df == NULL || col < 0 || col >= df->cols)
+    {
+        return ERROR;
+    }
+
+    const csvZoneMap_t *zm = df->zoneMap;
+    if(zm == NULL)
+    {
+        return TRUE;
+    }
+
+    if(block < 0 || block >= zm->blocks)
+    {
+        return ERROR;
+    }
+
+    size_t cell = (size_t)block * zm->cols + col;
+
+    return (zm->min[cell] <= hi && zm->max[cell] >= lo) ? TRUE : FALSE;
+}
+
+/**
+ * @brief Map a float onto an unsigned integer with the same ordering.
+ *
+ * Positive values get their sign bit set, negative values are bit-inverted, so comparing the results
+ * as unsigned integers orders them like the floats. -0 is folded onto +0 so that both compare equal, and
+ * every NaN onto one positive quiet NaN, which orders after +inf whatever its sign and payload.
+ */
+static uint32_t orderedKey(float value)
+{
+    uint32_t bits;
+
+    if(value == 0.0f)
+    {
+        value = 0.0f;
+    }
+    else if(isnan(value))
+    {
+        value = NAN;
+    }
+    memcpy(&bits, &value, sizeof(bits));
+
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+#ifdef CSV_HAVE_THREADS
+/**
+ * @brief Number of workers worth starting for 'work' rows or values, 1 when the step should stay serial.
+ */
+static int workerCount(long long work)
+{
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    long long workers = work / CSV_PARALLEL_WORK;
+
+    workers = workers < online ? workers : online;
+    workers = workers < CSV_MAX_THREADS ? workers : CSV_MAX_THREADS;
+
+    return workers > 1 ? (int)workers : 1;
+}
+
+/**
+ * @brief Run 'work' on 'workers' argument structs of 'argSize' bytes, the first on the calling thread.
+ *
+ * Returns once every worker is done. A worker whose thread cannot be started runs on the calling
+ * thread instead, so a step never fails for lack of threads, it only loses parallelism.
+ */
+static void runWorkers(void *(*work)(void *), void *args, size_t argSize, int workers)
+{
+    pthread_t threads[CSV_MAX_THREADS];
+    int started[CSV_MAX_THREADS] = {0};
+
+    for(int worker=1; worker<workers; worker++)
+    {
+        void *arg = (char *)args + worker * argSize;
+        started[worker] = pthread_create(&threads[worker], NULL, work, arg) == 0;
+        if( ! started[worker])
+        {
+            work(arg);
         }
     }
+    work(args);
+    for(int worker=1; worker<workers; worker++)
+    {
+        if(started[worker])
+        {
+            pthread_join(threads[worker], NULL);
+        }
+    }
+}
 
-    fclose(filePtr);
+typedef struct {
+    const csvData_t *df;
+    int col;
+    uint32_t flip;
+    int lo, hi;             //rows of this worker, in the current order
+    int shift;              //digit of the current pass
+    uint32_t *keys, *keysOut;
+    int *perm, *permOut;
+    int gather;             //first pass of a key: read the keys through 'perm' before counting
+    size_t count[256];      //digit counts, then the first destination of every digit
+}sortWork_t;
 
-    return df;
+static void *sortCount(void *arg)
+{
+    sortWork_t *work = (sortWork_t *)arg;
+
+    memset(work->count, 0, sizeof(work->count));
+    for(int row=work->lo; row<work->hi; row++)
+    {
+        if(work->gather)
+        {
+            work->keys[row] = orderedKey(work->df->dataFrame[work->perm[row]][work->col]) ^ work->flip;
+        }
+        work->count[(work->keys[row] >> work->shift) & 0xFF]++;
+    }
+
+    return NULL;
+}
+
+static void *sortScatter(void *arg)
+{
+    sortWork_t *work = (sortWork_t *)arg;
+
+    for(int row=work->lo; row<work->hi; row++)
+    {
+        size_t dst = work->count[(work->keys[row] >> work->shift) & 0xFF]++;
+        work->keysOut[dst] = work->keys[row];
+        work->permOut[dst] = work->perm[row];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Sort by one key with the passes of 'csvArgSort()' split over row ranges.
+ *
+ * Every pass counts digits per worker, turns the counts into per worker destinations, digit by digit
+ * and worker by worker so that equal digits keep their order, then lets every worker scatter its rows.
+ */
+static void sortKeyParallel(const csvData_t *df, int col, uint32_t flip, int rows, int workers,
+                            uint32_t **keys, uint32_t **keysTmp, int **perm, int **permTmp)
+{
+    sortWork_t work[CSV_MAX_THREADS];
+
+    for(int worker=0; worker<workers; worker++)
+    {
+        work[worker].df = df;
+        work[worker].col = col;
+        work[worker].flip = flip;
+        work[worker].lo = (int)((long long)rows * worker / workers);
+        work[worker].hi = (int)((long long)rows * (worker + 1) / workers);
+        work[worker].gather = 1;
+    }
+
+    for(int pass=0; pass<4; pass++)
+    {
+        size_t offset = 0;
+
+        for(int worker=0; worker<workers; worker++)
+        {
+            work[worker].shift = pass * 8;
+            work[worker].keys = *keys;
+            work[worker].keysOut = *keysTmp;
+            work[worker].perm = *perm;
+            work[worker].permOut = *permTmp;
+        }
+        runWorkers(sortCount, work, sizeof(sortWork_t), workers);
+
+        size_t same = 0, first = ((*keys)[0] >> (pass * 8)) & 0xFF;
+        for(int worker=0; worker<workers; worker++)
+        {
+            work[worker].gather = 0;
+            same += work[worker].count[first];
+        }
+        if(same == (size_t)rows)
+        {
+            continue; //every row has the same digit, the pass would not move anything
+        }
+
+        for(int digit=0; digit<256; digit++)
+        {
+            for(int worker=0; worker<workers; worker++)
+            {
+                size_t n = work[worker].count[digit];
+                work[worker].count[digit] = offset;
+                offset += n;
+            }
+        }
+        runWorkers(sortScatter, work, sizeof(sortWork_t), workers);
+
+        uint32_t *swapKeys = *keys;
+        *keys = *keysTmp;
+        *keysTmp = swapKeys;
+
+        int *swapPerm = *perm;
+        *perm = *permTmp;
+        *permTmp = swapPerm;
+    }
+}
+#endif
+
+/**
+ * @brief Compute the sorting permutation of a data frame by one or more columns.
+ *
+ * This function sorts the row indices of 'df' with a least significant digit radix sort over
+ * order-preserving 32-bit encodings of the key values. Keys are processed from the last to the first,
+ * each in four stable 8-bit passes, passes in which every row shares the same digit being skipped.
+ * The sort is stable, rows with equal keys keep their original order. NaN values, whatever their sign,
+ * sort after +inf in ascending order.
+ *
+ * The sort runs on the calling thread. When the library is compiled with CSV_ENABLE_THREADS on a POSIX
+ * system, frames of several times CSV_PARALLEL_WORK rows are sorted by up to CSV_MAX_THREADS
+ * pthreads: each worker counts the digits of its own range of rows, and after a prefix sum over
+ * digits and workers scatters its rows to their final place, which keeps the sort stable and the
+ * result identical to the serial one.
+ *
+ * @param df A pointer to the data frame to sort.
+ * @param cols The key column indices, the first one being the most significant.
+ * @param order The sort order of each key, or NULL to sort every key in ascending order.
+ * @param nKeys The number of key columns.
+ * @return A dynamically allocated array of 'df->rows' row indices in sorted order, or NULL if an error occurs.
+ *
+ * @note The caller is responsible for freeing the returned array.
+ *
+ * @code
+ *   // Example usage:
+ *   int keys[] = {0};
+ *   int *perm = csvArgSort(dataFrame, keys, NULL, 1);
+ *   if (perm != NULL)
+ *   {
+ *       printf("Smallest value is on row %d\n", perm[0]);
+ *       free(perm);
+ *   }
+ * @endcode
+ */
+int *csvArgSort(const csvData_t *df, const int *cols, const csvOrder_t *order, int nKeys)
+{
+    if(df == NULL || df->dataFrame == NULL || cols == NULL || nKeys <= 0)
+    {
+        return NULL;
+    }
+
+    for(int key=0; key<nKeys; key++)
+    {
+        if(cols[key] < 0 || cols[key] >= df->cols)
+        {
+            return NULL;
+        }
+    }
+
+    int rows = df->rows;
+    int *perm = (int *)malloc(sizeof(int) * (rows + 1));
+    int *permTmp = (int *)malloc(sizeof(int) * (rows + 1));
+    uint32_t *keys = (uint32_t *)malloc(sizeof(uint32_t) * (rows + 1));
+    uint32_t *keysTmp = (uint32_t *)malloc(sizeof(uint32_t) * (rows + 1));
+
+    if(perm == NULL || permTmp == NULL || keys == NULL || keysTmp == NULL)
+    {
+        free(perm);
+        free(permTmp);
+        free(keys);
+        free(keysTmp);
+        return NULL;
+    }
+
+    for(int row=0; row<rows; row++)
+    {
+        perm[row] = row;
+    }
+#ifdef CSV_HAVE_THREADS
+    int workers = workerCount(rows);
+#endif
+
+    for(int key=nKeys-1; key>=0; key--) //least significant key first
+    {
+        uint32_t flip = (order != NULL && order[key] == CSV_DESCENDING) ? 0xFFFFFFFFu : 0u;
+        size_t count[4][256] = {{0}};
+
+#ifdef CSV_HAVE_THREADS
+        if(workers > 1)
+        {
+            sortKeyParallel(df, cols[key], flip, rows, workers, &keys, &keysTmp, &perm, &permTmp);
+            continue;
+        }
+#endif
+
+        for(int row=0; row<rows; row++) //gather keys in the current order and histogram every digit at once
+        {
+            uint32_t k = orderedKey(df->dataFrame[perm[row]][cols[key]]) ^ flip;
+            keys[row] = k;
+            count[0][k & 0xFF]++;
+            count[1][(k >> 8) & 0xFF]++;
+            count[2][(k >> 16) & 0xFF]++;
+            count[3][k >> 24]++;
+        }
+
+        for(int pass=0; pass<4; pass++)
+        {
+            int shift = pass * 8;
+            size_t offset = 0;
+
+            if(rows == 0 || count[pass][(keys[0] >> shift) & 0xFF] == (size_t)rows)
+            {
+                continue; //every row has the same digit, the pass would not move anything
+            }
+
+            for(int digit=0; digit<256; digit++) //turn counts into starting offsets
+            {
+                size_t n = count[pass][digit];
+                count[pass][digit] = offset;
+                offset += n;
+            }
+
+            for(int row=0; row<rows; row++)
+            {
+                size_t dst = count[pass][(keys[row] >> shift) & 0xFF]++;
+                keysTmp[dst] = keys[row];
+                permTmp[dst] = perm[row];
+            }
+
+            uint32_t *swapKeys = keys;
+            keys = keysTmp;
+            keysTmp = swapKeys;
+
+            int *swapPerm = perm;
+            perm = permTmp;
+            permTmp = swapPerm;
+        }
+    }
+
+    free(permTmp);
+    free(keys);
+    free(keysTmp);
+
+    return perm;
+}
+
+/**
+ * @brief Sort the rows of a data frame in place by one or more columns.
+ *
+ * This function computes the sorting permutation with 'csvArgSort()' and applies it to the row table.
+ * Since every row is stored as its own array, applying the permutation only moves row pointers; no
+ * value is copied. The zone map, if present, is recomputed for the new row order.
+ *
+ * @param df A pointer to the data frame to sort.
+ * @param cols The key column indices, the first one being the most significant.
+ * @param order The sort order of each key, or NULL to sort every key in ascending order.
+ * @param nKeys The number of key columns.
+ * @return TRUE on success, ERROR if the arguments are invalid, FALSE if memory could not be allocated.
+ *
+ * @code
+ *   // Example usage:
+ *   int keys[] = {3, 0};
+ *   csvOrder_t order[] = {CSV_ASCENDING, CSV_DESCENDING};
+ *   if (csvSortBy(dataFrame, keys, order, 2) != TRUE)
+ *   {
+ *       puts("Error occurred while sorting the data frame.");
+ *   }
+ *   // Rows are now ordered by column 3, ties broken by column 0 descending...
+ * @endcode
+ */
+bool_t csvSortBy(csvData_t *df, const int *cols, const csvOrder_t *order, int nKeys)
+{
+    if(df == NULL || df->dataFrame == NULL || cols == NULL || nKeys <= 0)
+    {
+        return ERROR;
+    }
+
+    int *perm = csvArgSort(df, cols, order, nKeys);
+    float **sorted = (float **)malloc(sizeof(float *) * (df->rows + 1));
+
+    if(perm == NULL || sorted == NULL)
+    {
+        free(perm);
+        free(sorted);
+        return FALSE;
+    }
+
+    for(int row=0; row<df->rows; row++)
+    {
+        sorted[row] = df->dataFrame[perm[row]];
+    }
+
+    free(df->dataFrame);
+    df->dataFrame = sorted;
+    free(perm);
+
+    if(df->zoneMap != NULL)
+    {
+        return csvBuildZoneMap(df, df->zoneMap->blockRows);
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Allocate a data frame that is not backed by a file.
+ *
+ * Used by the functions that derive a new frame from existing ones. The feature names are left empty,
+ * the rows are carved out of a single contiguous block and left uninitialised, and no zone map is
+ * built. Returns NULL on failure.
+ */
+static csvData_t *allocDataFrame(int rows, int cols)
+{
+    csvData_t *df = (csvData_t *)malloc(sizeof(csvData_t));
+    if(df == NULL)
+    {
+        return NULL;
+    }
+
+    df->rows = rows;
+    df->cols = cols;
+    df->DFSize = (long)rows * cols;
+    df->zoneMap = NULL;
+    df->sketches = NULL;
+    df->hll = NULL;
+    df->parent = NULL;
+    df->mapping = NULL;
+    df->mappingSize = 0;
+    df->delim = (char *)malloc(sizeof(char) * (strlen(CSV_DELIM) + 1));
+    df->params = (char *)calloc(1, sizeof(char));
+    df->dataFrame = (float **)malloc(sizeof(float *) * (rows + 1));
+    df->block = (float *)malloc(sizeof(float) * ((size_t)rows * cols + 1));
+
+    if(df->delim == NULL || df->params == NULL || df->dataFrame == NULL || df->block == NULL)
+    {
+        freeDataFrame(df);
+        return NULL;
+    }
+    strcpy(df->delim, CSV_DELIM);
+
+    for(int row=0; row<rows; row++)
+    {
+        df->dataFrame[row] = df->block + (size_t)row * cols;
+    }
+
+    return df;
+}
+
+/**
+ * @brief Hash the key columns of a row. -0 and +0 hash alike, matching 'keysEqual()'.
+ */
+static uint64_t hashKeys(const float *row, const int *cols, int nKeys)
+{
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+
+    for(int key=0; key<nKeys; key++)
+    {
+        hash = (hash ^ orderedKey(row[cols[key]])) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 29;
+
+    return hash;
+}
+
+/**
+ * @brief Compare the key columns of two rows, possibly from different frames.
+ */
+static int keysEqual(const float *a, const int *aCols, const float *b, const int *bCols, int nKeys)
+{
+    for(int key=0; key<nKeys; key++)
+    {
+        if(orderedKey(a[aCols[key]]) != orderedKey(b[bCols[key]]))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Open addressing hash index over the key columns of the rows of a frame. A slot is 8 bytes, the
+ * upper hash bits as a tag plus the row index, so that eight slots share a cache line and linear
+ * probing rarely leaves the line the probe started in. The table only keeps one row per distinct key;
+ * callers chain or count duplicates on their own.
+ */
+typedef struct {
+    uint32_t tag;       //upper 32 bits of the key hash
+    int32_t row;        //representative row, -1 when the slot is empty
+}keySlot_t;
+
+typedef struct {
+    keySlot_t *slots;
+    size_t mask;        //number of slots - 1, the number of slots being a power of two
+    size_t used;
+    float **rows;       //rows of the indexed frame
+    const int *cols;    //key columns of the indexed frame
+    int nKeys;
+}keyIndex_t;
+
+static bool_t keyIndexInit(keyIndex_t *idx, size_t expected, float **rows, const int *cols, int nKeys)
+{
+    size_t size = 16;
+    while(size < expected * 2)
+    {
+        size <<= 1;
+    }
+
+    idx->slots = (keySlot_t *)malloc(sizeof(keySlot_t) * size);
+    if(idx->slots == NULL)
+    {
+        return FALSE;
+    }
+    for(size_t slot=0; slot<size; slot++)
+    {
+        idx->slots[slot].row = -1;
+    }
+
+    idx->mask = size - 1;
+    idx->used = 0;
+    idx->rows = rows;
+    idx->cols = cols;
+    idx->nKeys = nKeys;
+
+    return TRUE;
+}
+
+static void keyIndexFree(keyIndex_t *idx)
+{
+    free(idx->slots);
+    idx->slots = NULL;
+}
+
+/**
+ * @brief Find the representative row whose keys equal the keys of 'probe', or -1.
+ */
+static int keyIndexFind(const keyIndex_t *idx, uint64_t hash, const float *probe, const int *probeCols)
+{
+    uint32_t tag = (uint32_t)(hash >> 32);
+
+    for(size_t slot=hash & idx->mask; ; slot=(slot + 1) & idx->mask)
+    {
+        const keySlot_t *s = &idx->slots[slot];
+        if(s->row < 0)
+        {
+            return -1;
+        }
+        if(s->tag == tag && keysEqual(probe, probeCols, idx->rows[s->row], idx->cols, idx->nKeys))
+        {
+            return s->row;
+        }
+    }
+}
+
+/**
+ * @brief Add a row whose keys are not in the index yet, doubling the table above half load.
+ */
+static bool_t keyIndexInsert(keyIndex_t *idx, uint64_t hash, int row)
+{
+    if((idx->used + 1) * 2 > idx->mask + 1)
+    {
+        size_t size = (idx->mask + 1) * 2;
+        keySlot_t *old = idx->slots;
+        size_t oldSize = idx->mask + 1;
+
+        idx->slots = (keySlot_t *)malloc(sizeof(keySlot_t) * size);
+        if(idx->slots == NULL)
+        {
+            idx->slots = old;
+            return FALSE;
+        }
+        for(size_t slot=0; slot<size; slot++)
+        {
+            idx->slots[slot].row = -1;
+        }
+        idx->mask = size - 1;
+
+        for(size_t slot=0; slot<oldSize; slot++) //re-place existing entries, tags hold only half the hash
+        {
+            if(old[slot].row >= 0)
+            {
+                uint64_t h = hashKeys(idx->rows[old[slot].row], idx->cols, idx->nKeys);
+                size_t dst = h & idx->mask;
+                while(idx->slots[dst].row >= 0)
+                {
+                    dst = (dst + 1) & idx->mask;
+                }
+                idx->slots[dst] = old[slot];
+            }
+        }
+        free(old);
+    }
+
+    size_t slot = hash & idx->mask;
+    while(idx->slots[slot].row >= 0)
+    {
+        slot = (slot + 1) & idx->mask;
+    }
+    idx->slots[slot].tag = (uint32_t)(hash >> 32);
+    idx->slots[slot].row = row;
+    idx->used++;
+
+    return TRUE;
+}
+
+/**
+ * @brief Group the rows of a data frame by key columns and aggregate numeric columns.
+ *
+ * This function assigns every row to the group of its key values using an open addressing hash index
+ * and folds the aggregated columns of the row into the group's accumulators. The returned frame has
+ * one row per distinct key, in order of first appearance, holding the key columns followed by one
+ * column per aggregate. NaN values are ignored by every aggregate; CSV_COUNT counts the non-NaN values
+ * and the other aggregates of a group without any value are NaN. Keys compare by value except that
+ * -0 equals +0 and every NaN equals every other NaN, so all NaN keys form a single group.
+ *
+ * @param df A pointer to the data frame to group.
+ * @param keyCols The key column indices.
+ * @param nKeys The number of key columns.
+ * @param aggs The aggregates to compute, each a column and a function.
+ * @param nAggs The number of aggregates.
+ * @return A pointer to a dynamically allocated 'csvData_t' holding the groups, or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   int keys[] = {3};
+ *   csvAgg_t aggs[] = {{0, CSV_MEAN}, {1, CSV_MAX}, {1, CSV_COUNT}};
+ *   csvData_t *groups = csvGroupBy(dataFrame, keys, 1, aggs, 3);
+ *   if (groups != NULL)
+ *   {
+ *       for (int row = 0; row < groups->rows; row++)
+ *       {
+ *           printf("%f: mean %f, max %f, count %f\n", groups->dataFrame[row][0],
+ *                  groups->dataFrame[row][1], groups->dataFrame[row][2], groups->dataFrame[row][3]);
+ *       }
+ *       freeDataFrame(groups);
+ *   }
+ * @endcode
+ */
+csvData_t *csvGroupBy(const csvData_t *df, const int *keyCols, int nKeys, const csvAgg_t *aggs, int nAggs)
+{
+    if(df == NULL || df->dataFrame == NULL || keyCols == NULL || nKeys <= 0 || (aggs == NULL && nAggs > 0) || nAggs < 0)
+    {
+        return NULL;
+    }
+    for(int key=0; key<nKeys; key++)
+    {
+        if(keyCols[key] < 0 || keyCols[key] >= df->cols)
+        {
+            return NULL;
+        }
+    }
+    for(int agg=0; agg<nAggs; agg++)
+    {
+        if(aggs[agg].col < 0 || aggs[agg].col >= df->cols)
+        {
+            return NULL;
+        }
+    }
+
+    keyIndex_t idx;
+    int groups = 0, capacity = 64;
+    int *groupOf = (int *)malloc(sizeof(int) * (df->rows + 1));     //group of each representative row
+    int *firstRow = (int *)malloc(sizeof(int) * capacity);          //representative row of each group
+    double *acc = (double *)malloc(sizeof(double) * capacity * (nAggs + 1)); //one accumulator per aggregate
+    long *count = (long *)malloc(sizeof(long) * capacity * (nAggs + 1));     //non-NaN values per aggregate
+
+    if(groupOf == NULL || firstRow == NULL || acc == NULL || count == NULL ||
+       keyIndexInit(&idx, 1024, df->dataFrame, keyCols, nKeys) != TRUE)
+    {
+        free(groupOf);
+        free(firstRow);
+        free(acc);
+        free(count);
+        return NULL;
+    }
+
+    bool_t ok = TRUE;
+    for(int row=0; row<df->rows && ok == TRUE; row++)
+    {
+        const float *values = df->dataFrame[row];
+        uint64_t hash = hashKeys(values, keyCols, nKeys);
+        int rep = keyIndexFind(&idx, hash, values, keyCols);
+        int group;
+
+        if(rep < 0) //first row of a new group
+        {
+            if(groups == capacity)
+            {
+                capacity *= 2;
+                int *newFirst = (int *)realloc(firstRow, sizeof(int) * capacity);
+                double *newAcc = (double *)realloc(acc, sizeof(double) * capacity * (nAggs + 1));
+                long *newCount = (long *)realloc(count, sizeof(long) * capacity * (nAggs + 1));
+                firstRow = newFirst != NULL ? newFirst : firstRow;
+                acc = newAcc != NULL ? newAcc : acc;
+                count = newCount != NULL ? newCount : count;
+                if(newFirst == NULL || newAcc == NULL || newCount == NULL)
+                {
+                    ok = FALSE;
+                    break;
+                }
+            }
+
+            group = groups++;
+            firstRow[group] = row;
+            groupOf[row] = group;
+            for(int agg=0; agg<nAggs; agg++)
+            {
+                size_t cell = (size_t)group * nAggs + agg;
+                count[cell] = 0;
+                acc[cell] = (aggs[agg].op == CSV_MIN) ? INFINITY : (aggs[agg].op == CSV_MAX) ? -INFINITY : 0.0;
+            }
+            ok = keyIndexInsert(&idx, hash, row);
+        }
+        else
+        {
+            group = groupOf[rep];
+        }
+
+        for(int agg=0; agg<nAggs; agg++)
+        {
+            float value = values[aggs[agg].col];
+            size_t cell = (size_t)group * nAggs + agg;
+
+            if(isnan(value))
+            {
+                continue;
+            }
+            count[cell]++;
+            switch(aggs[agg].op)
+            {
+                case CSV_SUM:
+                case CSV_MEAN:
+                    acc[cell] += value;
+                    break;
+                case CSV_MIN:
+                    if(value < acc[cell]) acc[cell] = value;
+                    break;
+                case CSV_MAX:
+                    if(value > acc[cell]) acc[cell] = value;
+                    break;
+                case CSV_COUNT:
+                    break;
+            }
+        }
+    }
+
+    keyIndexFree(&idx);
+    free(groupOf);
+
+    csvData_t *out = (ok == TRUE) ? allocDataFrame(groups, nKeys + nAggs) : NULL;
+    if(out != NULL)
+    {
+        for(int group=0; group<groups; group++)
+        {
+            float *dst = out->dataFrame[group];
+            const float *src = df->dataFrame[firstRow[group]];
+
+            for(int key=0; key<nKeys; key++)
+            {
+                dst[key] = src[keyCols[key]];
+            }
+            for(int agg=0; agg<nAggs; agg++)
+            {
+                size_t cell = (size_t)group * nAggs + agg;
+                if(aggs[agg].op == CSV_COUNT)
+                {
+                    dst[nKeys + agg] = (float)count[cell];
+                }
+                else if(count[cell] == 0)
+                {
+                    dst[nKeys + agg] = NAN;
+                }
+                else
+                {
+                    dst[nKeys + agg] = (float)(aggs[agg].op == CSV_MEAN ? acc[cell] / count[cell] : acc[cell]);
+                }
+            }
+        }
+    }
+
+    free(firstRow);
+    free(acc);
+    free(count);
+
+    return out;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) ((void)0)
+#endif
+
+#define JOIN_BATCH (16)     //probe rows hashed and prefetched ahead of their lookups
+
+/**
+ * @brief Join two data frames on equal key columns.
+ *
+ * This function computes the inner equi-join of 'left' and 'right'. A hash index is built over the
+ * keys of the smaller frame and the rows of the larger frame probe it in batches of JOIN_BATCH, the
+ * slots of a whole batch being prefetched before any of them is compared. When the smaller frame has
+ * more than CSV_JOIN_PARTITION_ROWS rows, both frames are first radix partitioned by key hash so that
+ * each partition's index stays cache resident. Matches are collected as row pairs, then written into
+ * a result frame allocated once as a single block.
+ *
+ * The result holds every column of 'left' followed by the columns of 'right' that are not keys. Rows
+ * are in the order of the larger frame unless the join was partitioned. Keys compare as in
+ * 'csvGroupBy()': -0 matches +0, and NaN keys match each other.
+ *
+ * @param left A pointer to the left data frame.
+ * @param leftKeys The key column indices in 'left'.
+ * @param right A pointer to the right data frame.
+ * @param rightKeys The key column indices in 'right', matched with 'leftKeys' one by one.
+ * @param nKeys The number of key columns.
+ * @return A pointer to a dynamically allocated 'csvData_t' holding the joined rows, or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   int factKey[] = {2};
+ *   int dimKey[] = {0};
+ *   csvData_t *joined = csvJoin(facts, factKey, dimension, dimKey, 1);
+ *   if (joined != NULL)
+ *   {
+ *       printf("%d matching rows, %d columns\n", joined->rows, joined->cols);
+ *       freeDataFrame(joined);
+ *   }
+ * @endcode
+ */
+csvData_t *csvJoin(const csvData_t *left, const int *leftKeys, const csvData_t *right, const int *rightKeys, int nKeys)
+{
+    if(left == NULL || right == NULL || left->dataFrame == NULL || right->dataFrame == NULL ||
+       leftKeys == NULL || rightKeys == NULL || nKeys <= 0)
+    {
+        return NULL;
+    }
+
+    char *rightIsKey = (char *)calloc(right->cols + 1, sizeof(char));
+    if(rightIsKey == NULL)
+    {
+        return NULL;
+    }
+    for(int key=0; key<nKeys; key++)
+    {
+        if(leftKeys[key] < 0 || leftKeys[key] >= left->cols || rightKeys[key] < 0 || rightKeys[key] >= right->cols)
+        {
+            free(rightIsKey);
+            return NULL;
+        }
+        rightIsKey[rightKeys[key]] = 1;
+    }
+
+    int buildIsLeft = left->rows < right->rows;
+    const csvData_t *build = buildIsLeft ? left : right;
+    const csvData_t *probe = buildIsLeft ? right : left;
+    const int *buildKeys = buildIsLeft ? leftKeys : rightKeys;
+    const int *probeKeys = buildIsLeft ? rightKeys : leftKeys;
+
+    int parts = 1, partBits = 0;
+    while((long)build->rows / parts > CSV_JOIN_PARTITION_ROWS && partBits < 12)
+    {
+        parts <<= 1;
+        partBits++;
+    }
+
+    uint64_t *buildHash = (uint64_t *)malloc(sizeof(uint64_t) * (build->rows + 1));
+    uint64_t *probeHash = (uint64_t *)malloc(sizeof(uint64_t) * (probe->rows + 1));
+    int *buildOrder = (int *)malloc(sizeof(int) * (build->rows + 1));   //build rows grouped by partition
+    int *probeOrder = (int *)malloc(sizeof(int) * (probe->rows + 1));   //probe rows grouped by partition
+    int *buildStart = (int *)calloc(parts + 1, sizeof(int));
+    int *probeStart = (int *)calloc(parts + 1, sizeof(int));
+    int *next = (int *)malloc(sizeof(int) * (build->rows + 1));        //next build row with the same keys
+    int *last = (int *)malloc(sizeof(int) * (build->rows + 1));        //last row of each chain, by head row
+    long pairs = 0, pairCapacity = 1024;
+    int *pairBuild = (int *)malloc(sizeof(int) * pairCapacity);
+    int *pairProbe = (int *)malloc(sizeof(int) * pairCapacity);
+    bool_t ok = (buildHash && probeHash && buildOrder && probeOrder && buildStart && probeStart &&
+                 next && last && pairBuild && pairProbe) ? TRUE : FALSE;
+
+    //PARTITION ---------------------------------------------------------------
+
+    for(int side=0; side<2 && ok == TRUE; side++)
+    {
+        const csvData_t *df = side == 0 ? build : probe;
+        const int *keys = side == 0 ? buildKeys : probeKeys;
+        uint64_t *hash = side == 0 ? buildHash : probeHash;
+        int *order = side == 0 ? buildOrder : probeOrder;
+        int *start = side == 0 ? buildStart : probeStart;
+
+        for(int row=0; row<df->rows; row++)
+        {
+            hash[row] = hashKeys(df->dataFrame[row], keys, nKeys);
+            start[partBits ? (hash[row] >> (64 - partBits)) + 1 : 1]++;
+        }
+        for(int part=0; part<parts; part++) //counts to offsets
+        {
+            start[part + 1] += start[part];
+        }
+        for(int row=0; row<df->rows; row++)
+        {
+            order[start[partBits ? hash[row] >> (64 - partBits) : 0]++] = row;
+        }
+        for(int part=parts; part>0; part--) //scatter moved every offset one partition ahead
+        {
+            start[part] = start[part - 1];
+        }
+        start[0] = 0;
+    }
+
+    //BUILD AND PROBE EACH PARTITION ------------------------------------------
+
+    for(int part=0; part<parts && ok == TRUE; part++)
+    {
+        keyIndex_t idx;
+        if(keyIndexInit(&idx, buildStart[part + 1] - buildStart[part], build->dataFrame, buildKeys, nKeys) != TRUE)
+        {
+            ok = FALSE;
+            break;
+        }
+
+        for(int at=buildStart[part]; at<buildStart[part + 1] && ok == TRUE; at++)
+        {
+            int row = buildOrder[at];
+            int head = keyIndexFind(&idx, buildHash[row], build->dataFrame[row], buildKeys);
+
+            next[row] = -1;
+            if(head < 0)
+            {
+                last[row] = row;
+                ok = keyIndexInsert(&idx, buildHash[row], row);
+            }
+            else
+            {
+                next[last[head]] = row; //append, so matches come out in build order
+                last[head] = row;
+            }
+        }
+
+        for(int batch=probeStart[part]; batch<probeStart[part + 1] && ok == TRUE; batch+=JOIN_BATCH)
+        {
+            int end = batch + JOIN_BATCH < probeStart[part + 1] ? batch + JOIN_BATCH : probeStart[part + 1];
+
+            for(int at=batch; at<end; at++)
+            {
+                PREFETCH(&idx.slots[probeHash[probeOrder[at]] & idx.mask]);
+            }
+
+            for(int at=batch; at<end && ok == TRUE; at++)
+            {
+                int row = probeOrder[at];
+                int match = keyIndexFind(&idx, probeHash[row], probe->dataFrame[row], probeKeys);
+
+                for(; match>=0; match=next[match])
+                {
+                    if(pairs == pairCapacity)
+                    {
+                        pairCapacity *= 2;
+                        int *newBuild = (int *)realloc(pairBuild, sizeof(int) * pairCapacity);
+                        int *newProbe = (int *)realloc(pairProbe, sizeof(int) * pairCapacity);
+                        pairBuild = newBuild != NULL ? newBuild : pairBuild;
+                        pairProbe = newProbe != NULL ? newProbe : pairProbe;
+                        if(newBuild == NULL || newProbe == NULL || pairCapacity > 0x7FFFFFFF)
+                        {
+                            ok = FALSE;
+                            break;
+                        }
+                    }
+                    pairBuild[pairs] = match;
+                    pairProbe[pairs] = row;
+                    pairs++;
+                }
+            }
+        }
+
+        keyIndexFree(&idx);
+    }
+
+    //MATERIALIZE -------------------------------------------------------------
+
+    csvData_t *out = NULL;
+    if(ok == TRUE)
+    {
+        out = allocDataFrame((int)pairs, left->cols + right->cols - nKeys);
+    }
+    if(out != NULL)
+    {
+        for(long pair=0; pair<pairs; pair++)
+        {
+            const float *l = buildIsLeft ? left->dataFrame[pairBuild[pair]] : left->dataFrame[pairProbe[pair]];
+            const float *r = buildIsLeft ? right->dataFrame[pairProbe[pair]] : right->dataFrame[pairBuild[pair]];
+            float *dst = out->dataFrame[pair];
+
+            memcpy(dst, l, sizeof(float) * left->cols);
+            dst += left->cols;
+            for(int col=0; col<right->cols; col++)
+            {
+                if( ! rightIsKey[col])
+                {
+                    *dst++ = r[col];
+                }
+            }
+        }
+    }
+
+    free(rightIsKey);
+    free(buildHash);
+    free(probeHash);
+    free(buildOrder);
+    free(probeOrder);
+    free(buildStart);
+    free(probeStart);
+    free(next);
+    free(last);
+    free(pairBuild);
+    free(pairProbe);
+
+    return out;
+}
+
+/**
+ * @brief splitmix64, the seeded generator behind the sampling and splitting functions.
+ */
+static uint64_t nextRandom(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Hash a run of bytes, eight at a time, into 64 bits.
+ */
+static uint64_t hashBytes(const void *data, size_t len)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ (len * 0xFF51AFD7ED558CCDull);
+    uint64_t word;
+
+    for(; len>=8; len-=8, bytes+=8)
+    {
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0xC4CEB9FE1A85EC53ull;
+        hash ^= hash >> 31;
+    }
+
+    word = 0;
+    memcpy(&word, bytes, len); //tail, zero padded
+    hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 29;
+
+    return hash;
+}
+
+/**
+ * @brief Fold a hash into the HyperLogLog registers of one column.
+ *
+ * The top CSV_HLL_BITS bits choose the register, which keeps the longest run of leading zeros, plus
+ * one, seen in the remaining bits.
+ */
+static void hllAdd(unsigned char *registers, uint64_t hash)
+{
+    size_t reg = (size_t)(hash >> (64 - CSV_HLL_BITS));
+    uint64_t rest = hash << CSV_HLL_BITS;
+    unsigned char rank = 1;
+
+    while(rank <= 64 - CSV_HLL_BITS && (rest & 0x8000000000000000ull) == 0)
+    {
+        rest <<= 1;
+        rank++;
+    }
+
+    if(rank > registers[reg])
+    {
+        registers[reg] = rank;
+    }
+}
+
+/**
+ * @brief Length of a field without the line break 'fgets()' leaves on the last field of a line.
+ */
+static size_t fieldLength(const char *token)
+{
+    size_t len = strlen(token);
+
+    while(len > 0 && (token[len - 1] == '\n' || token[len - 1] == '\r'))
+    {
+        len--;
+    }
+
+    return len;
+}
+
+/*
+ * Load statistics, see csvStats_t. Unless the library is compiled with CSV_ENABLE_STATS the macros
+ * below expand to nothing and loads never read a clock. Counters are exact; stage times are taken
+ * on one record in CSV_STATS_SAMPLE and scaled up, which keeps the clock reads of a load cheap.
+ */
+typedef struct {
+    int on;             //the current record is timed
+    double scale;       //number of records a timed record stands for
+    double wall, cpu;   //time of the last mark
+    double costWall, costCpu; //time taken by reading the clocks, taken off every stage
+    int perf[CSV_COUNTERS];   //hardware counter descriptors of the whole load, -1 when not open
+}statsTimer_t;
+
+/**
+ * @brief Seconds of a monotonic clock, shared by the statistics and the tracer.
+ */
+static double wallClock(void)
+{
+#ifdef CSV_HAVE_MMAP
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC; //no portable monotonic clock in C99
+#endif
+}
+
+#ifdef CSV_ENABLE_STATS
+
+static void statsNow(double *wall, double *cpu)
+{
+    *wall = wallClock();
+#ifdef CSV_HAVE_MMAP
+    struct timespec now;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now); //loads may run concurrently
+    *cpu = (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+#else
+    *cpu = (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/**
+ * @brief Measure what one mark costs, reading a CPU clock may take a system call.
+ */
+static void statsCalibrate(statsTimer_t *timer)
+{
+    double wall, cpu, nextWall, nextCpu;
+
+    timer->costWall = timer->costCpu = INFINITY;
+    statsNow(&wall, &cpu);
+    for(int probe=0; probe<8; probe++)
+    {
+        statsNow(&nextWall, &nextCpu);
+        timer->costWall = fmin(timer->costWall, nextWall - wall);
+        timer->costCpu = fmin(timer->costCpu, nextCpu - cpu);
+        wall = nextWall;
+        cpu = nextCpu;
+    }
+}
+
+static void statsStart(statsTimer_t *timer, int on, double scale)
+{
+    timer->on = on;
+    timer->scale = scale;
+    if(on)
+    {
+        statsNow(&timer->wall, &timer->cpu);
+    }
+}
+
+/**
+ * @brief Charge the time since the last mark of 'timer' to 'stage' and mark again.
+ */
+static void statsStage(csvStats_t *stats, statsTimer_t *timer, csvStage_t stage)
+{
+    double wall, cpu;
+
+    statsNow(&wall, &cpu);
+    stats->wall[stage] += fmax(wall - timer->wall - timer->costWall, 0.0) * timer->scale;
+    stats->cpu[stage] += fmax(cpu - timer->cpu - timer->costCpu, 0.0) * timer->scale;
+    timer->wall = wall;
+    timer->cpu = cpu;
+}
+
+#ifdef CSV_HAVE_PERF
+static const struct {uint32_t type; uint64_t config;} perfEvents[CSV_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+#endif
+
+/**
+ * @brief Start the hardware counters of the calling thread, each one that cannot be opened stays -1.
+ *
+ * Counters are opened one by one rather than as a group, so a machine short of counters, or a
+ * kernel that refuses some events, still reports the others. Kernel time is excluded, which
+ * 'perf_event_paranoid' levels up to 2 allow for unprivileged users.
+ */
+static void statsCountersOpen(statsTimer_t *total)
+{
+    for(int counter=0; counter<CSV_COUNTERS; counter++)
+    {
+        total->perf[counter] = -1;
+#ifdef CSV_HAVE_PERF
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perfEvents[counter].type;
+        attr.config = perfEvents[counter].config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        total->perf[counter] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+}
+
+/**
+ * @brief Read and close the hardware counters, scaling up counts the kernel had to multiplex.
+ */
+static void statsCountersClose(csvStats_t *stats, const statsTimer_t *total)
+{
+    for(int counter=0; counter<CSV_COUNTERS; counter++)
+    {
+        stats->counters[counter] = -1;
+#ifdef CSV_HAVE_PERF
+        uint64_t value[3]; //count, time enabled, time running
+
+        if(total->perf[counter] < 0)
+        {
+            continue;
+        }
+        if(read(total->perf[counter], value, sizeof(value)) == (ssize_t)sizeof(value) && value[2] > 0)
+        {
+            stats->counters[counter] = (long long)((double)value[0] * ((double)value[1] / (double)value[2]));
+        }
+        close(total->perf[counter]);
+#endif
+    }
+}
+
+static void statsTotal(csvStats_t *stats, const statsTimer_t *total)
+{
+    double wall, cpu;
+
+    statsNow(&wall, &cpu);
+    statsCountersClose(stats, total);
+    stats->totalWall = wall - total->wall;
+    stats->totalCpu = cpu - total->cpu;
+}
+
+static void statsHold(csvStats_t *stats, long long bytes)
+{
+    stats->bytesHeld += (size_t)bytes;
+    if(stats->bytesHeld > stats->peakBytes)
+    {
+        stats->peakBytes = stats->bytesHeld;
+    }
+}
+
+#define STATS_COUNT(stats, member, n) do { if((stats) != NULL) { (stats)->member += (n); } } while(0)
+#define STATS_HOLD(stats, bytes) do { if((stats) != NULL) { statsHold((stats), (long long)(bytes)); } } while(0)
+#define STATS_CALIBRATE(stats, timer) do { if((stats) != NULL) { statsCalibrate(&(timer)); } } while(0)
+#define STATS_COUNTERS(stats, timer) do { if((stats) != NULL) { statsCountersOpen(&(timer)); } } while(0)
+#define STATS_START(stats, timer, on, scale) do { if((stats) != NULL) { statsStart(&(timer), (on), (scale)); } } while(0)
+#define STATS_STAGE(stats, timer, stage) do { if((stats) != NULL && (timer).on) { statsStage((stats), &(timer), (stage)); } } while(0)
+#define STATS_TOTAL(stats, timer) do { if((stats) != NULL) { statsTotal((stats), &(timer)); } } while(0)
+
+#else
+
+#define STATS_COUNT(stats, member, n) ((void)(stats))
+#define STATS_HOLD(stats, bytes) ((void)(stats), (void)(bytes))
+#define STATS_CALIBRATE(stats, timer) ((void)(stats), (void)(timer))
+#define STATS_COUNTERS(stats, timer) ((void)(stats), (void)(timer))
+#define STATS_START(stats, timer, on, scale) ((void)(stats), (void)(timer))
+#define STATS_STAGE(stats, timer, stage) ((void)(stats), (void)(timer))
+#define STATS_TOTAL(stats, timer) ((void)(stats), (void)(timer))
+
+#endif
+
+/*
+ * Tracing, see csvTracer_t. Spans cover whole stages or blocks of CSV_TRACE_ROWS records, so a
+ * traced load reads the clock a few times per block and never per record.
+ */
+static double traceBegin(const csvTracer_t *tracer)
+{
+    return tracer != NULL ? wallClock() * 1e6 : 0.0;
+}
+
+static void traceEnd(csvTracer_t *tracer, const char *name, double start, long records, long long bytes)
+{
+    if(tracer == NULL)
+    {
+        return;
+    }
+
+    csvTraceEvent_t *event = &tracer->events[tracer->count % tracer->capacity];
+
+    event->name = name;
+    event->start = start;
+    event->duration = wallClock() * 1e6 - start;
+    event->records = records;
+    event->bytes = bytes;
+    tracer->count++;
+}
+
+/*
+ * Per column converters. The loader picks one per column from its type before reading rows, so the
+ * row loop makes one indirect call per field and never branches on the type.
+ */
+typedef struct {
+    uint64_t buckets;   //number of buckets of CSV_HASHED columns
+    long fallbacks;     //fields converted by the C library, see csvStats_t
+}convertCtx_t;
+
+typedef float (*converter_t)(const char *token, convertCtx_t *ctx);
+
+static const double exactPow10[] = { //powers of ten that are exact doubles
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief Convert a decimal field, falling back to 'strtod()' whenever the fast path could round differently.
+ *
+ * Plain [sign]digits[.digits] fields with at most 19 digits and a mantissa below 2^53 are computed
+ * as an exact integer divided by an exact power of ten, which IEEE division rounds exactly like
+ * 'strtod()'. Leading blanks, exponents, hexadecimal, infinities and NaN take the slow path.
+ */
+static float convertFloat(const char *token, convertCtx_t *ctx)
+{
+    const char *at = token;
+    uint64_t mantissa = 0;
+    int digits = 0, fraction = 0, negative = 0;
+
+    if(*at == '-' || *at == '+')
+    {
+        negative = *at == '-';
+        at++;
+    }
+    for(; *at >= '0' && *at <= '9'; at++, digits++)
+    {
+        mantissa = mantissa * 10 + (uint64_t)(*at - '0');
+    }
+    if(*at == '.')
+    {
+        for(at++; *at >= '0' && *at <= '9'; at++, digits++, fraction++)
+        {
+            mantissa = mantissa * 10 + (uint64_t)(*at - '0');
+        }
+    }
+
+    if(digits == 0 || digits > 19 || mantissa > (1ull << 53) || fraction > 22 ||
+       *at == 'e' || *at == 'E' || *at == 'x' || *at == 'X')
+    {
+        ctx->fallbacks++;
+        return (float)strtod(token, NULL); //slow path
+    }
+
+    double value = (double)mantissa / exactPow10[fraction];
+
+    return (float)(negative ? -value : value);
+}
+
+/**
+ * @brief Convert an integer field, truncating any fraction like 'strtol()'.
+ */
+static float convertInt(const char *token, convertCtx_t *ctx)
+{
+    const char *at = token;
+    int64_t value = 0;
+    int digits = 0, negative = 0;
+
+    if(*at == '-' || *at == '+')
+    {
+        negative = *at == '-';
+        at++;
+    }
+    for(; *at >= '0' && *at <= '9' && digits < 18; at++, digits++)
+    {
+        value = value * 10 + (*at - '0');
+    }
+
+    if(digits == 0 || digits == 18) //blanks, or possibly out of the fast range
+    {
+        ctx->fallbacks++;
+        return (float)strtoll(token, NULL, 10);
+    }
+
+    return (float)(negative ? -value : value);
+}
+
+/**
+ * @brief Store the hash bucket of the raw field bytes, see 'opts->hashCols'.
+ */
+static float convertHashed(const char *token, convertCtx_t *ctx)
+{
+    return (float)(hashBytes(token, fieldLength(token)) % ctx->buckets);
+}
+
+/**
+ * @brief Store NaN without reading the field.
+ */
+static float convertSkip(const char *token, convertCtx_t *ctx)
+{
+    (void)token;
+    (void)ctx;
+
+    return NAN;
+}
+
+/**
+ * @brief Tell whether the columns typed CSV_HASHED among the first 'cols' have buckets to hash into.
+ *
+ * 'hashCols' is checked up front, 'colTypes' only once the number of file columns is known.
+ */
+static bool_t hashTypesValid(const csvLoadOpts_t *opts, int cols)
+{
+    for(int col=0; opts->colTypes != NULL && col<cols; col++)
+    {
+        if(opts->colTypes[col] == CSV_HASHED && opts->hashBuckets <= 0)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static converter_t converterFor(csvType_t type)
+{
+    switch(type)
+    {
+        case CSV_INT:
+            return convertInt;
+        case CSV_HASHED:
+            return convertHashed;
+        case CSV_SKIP:
+            return convertSkip;
+        case CSV_FLOAT:
+        default:
+            return convertFloat;
+    }
+}
+
+/**
+ * @brief Shrink a frame to its first 'rows' rows, releasing the others and fixing the zone map size.
+ */
+static void trimRows(csvData_t *df, int rows)
+{
+    if(rows >= df->rows)
+    {
+        return;
+    }
+
+    for(int row=rows; row<df->rows && rowsOwned(df); row++)
+    {
+        free(df->dataFrame[row]);
+    }
+    df->rows = rows;
+
+    if(df->zoneMap != NULL) //trailing blocks never received a row, earlier ones are complete
+    {
+        df->zoneMap->blocks = (rows + df->zoneMap->blockRows - 1) / df->zoneMap->blockRows;
+    }
+}
+
+/**
+ * @brief Find duplicate rows of a data frame, and mark or remove them.
+ *
+ * This function hashes the selected columns of every row and looks them up in a hash index holding
+ * one row per distinct key. The first occurrence of a key is kept, every later row with the same
+ * values in 'cols' is a duplicate. Values compare as keys of 'csvGroupBy()' do: -0 equals +0, and
+ * every NaN, whatever its sign or payload, matches every other.
+ *
+ * If 'dupMask' is not NULL, it receives 1 for every duplicate row and 0 otherwise and the frame is
+ * left untouched. If it is NULL, duplicates are removed in place, keeping the order of the remaining
+ * rows, and the zone map is recomputed.
+ *
+ * @param df A pointer to the data frame.
+ * @param cols The column indices that make up a row's identity, or NULL to compare every column.
+ * @param nCols The number of entries in 'cols', ignored when 'cols' is NULL.
+ * @param dupMask An array of 'df->rows' flags to fill, or NULL to remove the duplicates.
+ * @return The number of duplicate rows found, or -1 if an error occurs.
+ *
+ * @code
+ *   // Example usage:
+ *   int key[] = {0, 1};
+ *   int removed = csvDedup(dataFrame, key, 2, NULL);
+ *   if (removed >= 0)
+ *   {
+ *       printf("%d duplicate rows removed, %d left\n", removed, dataFrame->rows);
+ *   }
+ * @endcode
+ */
+int csvDedup(csvData_t *df, const int *cols, int nCols, unsigned char *dupMask)
+{
+    if(df == NULL || df->dataFrame == NULL || (cols != NULL && nCols <= 0))
+    {
+        return -1;
+    }
+
+    int *keys = (int *)malloc(sizeof(int) * (df->cols + 1));
+    if(keys == NULL)
+    {
+        return -1;
+    }
+    if(cols == NULL)
+    {
+        nCols = df->cols;
+    }
+    for(int col=0; col<nCols; col++)
+    {
+        keys[col] = cols != NULL ? cols[col] : col;
+        if(keys[col] < 0 || keys[col] >= df->cols || col >= df->cols)
+        {
+            free(keys);
+            return -1;
+        }
+    }
+
+    keyIndex_t idx;
+    if(keyIndexInit(&idx, 1024, df->dataFrame, keys, nCols) != TRUE)
+    {
+        free(keys);
+        return -1;
+    }
+
+    int kept = 0, duplicates = 0;
+    for(int row=0; row<df->rows; row++)
+    {
+        uint64_t hash = hashKeys(df->dataFrame[row], keys, nCols);
+        int dup = keyIndexFind(&idx, hash, df->dataFrame[row], keys) >= 0;
+
+        duplicates += dup;
+        if(dupMask != NULL)
+        {
+            dupMask[row] = (unsigned char)dup;
+        }
+
+        if(dup)
+        {
+            if(dupMask == NULL && rowsOwned(df))
+            {
+                free(df->dataFrame[row]);
+            }
+            continue;
+        }
+
+        int at = dupMask != NULL ? row : kept++;
+        df->dataFrame[at] = df->dataFrame[row]; //compact before indexing, the index reads rows through the table
+        if(keyIndexInsert(&idx, hash, at) != TRUE)
+        {
+            keyIndexFree(&idx);
+            free(keys);
+            return -1;
+        }
+    }
+
+    keyIndexFree(&idx);
+    free(keys);
+
+    if(dupMask == NULL && duplicates > 0)
+    {
+        df->rows = kept;
+        if(df->zoneMap != NULL)
+        {
+            csvBuildZoneMap(df, df->zoneMap->blockRows);
+        }
+    }
+
+    return duplicates;
+}
+
+/**
+ * @brief Remove a hash from the linear probing set of the streaming deduplication.
+ *
+ * Entries after the removed one are shifted back into the gap when their home slot allows it, so
+ * lookups keep stopping at the first empty slot without needing tombstones.
+ */
+static void seenRemove(uint64_t *seen, size_t mask, uint64_t hash)
+{
+    size_t bucket = hash & mask;
+
+    while(seen[bucket] != hash)
+    {
+        if(seen[bucket] == 0)
+        {
+            return;
+        }
+        bucket = (bucket + 1) & mask;
+    }
+
+    for(size_t next=(bucket + 1) & mask; seen[next] != 0; next=(next + 1) & mask)
+    {
+        size_t home = seen[next] & mask;
+        if(((next - home) & mask) >= ((next - bucket) & mask)) //the gap lies on the probe path of 'next'
+        {
+            seen[bucket] = seen[next];
+            bucket = next;
+        }
+    }
+    seen[bucket] = 0;
+}
+
+/**
+ * @brief Load data from a '.csv' file into a CSV data frame, with load options.
+ *
+ * This function behaves like 'loadCsv()' and additionally applies the options in 'opts', which may be
+ * NULL to get the plain 'loadCsv()' behaviour. 'opts->path' selects the file to load instead of
+ * CSV_PATH. Fields are split without 'strtok()', so several loads may run on different threads.
+ *
+ * Lookups: for each entry of 'opts->lookups', a hash index is built over the key column of the lookup
+ * frame before the file is read. As every row is parsed, its 'keyCol' value is looked up and the
+ * columns of the matching lookup row, except its key, are written right after the file's columns, in
+ * the order of the lookups. Rows without a match get NaN in those columns. If a lookup frame holds the
+ * same key more than once, its first row is used. This replaces a separate 'csvJoin()' pass over the
+ * whole frame when enriching rows with small dimension tables.
+ *
+ * Streaming deduplication: when 'opts->dedupCapacity' is positive, the 64-bit hash of the
+ * 'opts->dedupCols' values of the last 'dedupCapacity' rows kept is held in a set, and rows whose
+ * hash is already in it are dropped before they reach the frame. Once the set is full, the oldest
+ * hash leaves it as each new row is kept, so memory stays bounded and only duplicates within that
+ * sliding window are caught; use 'csvDedup()' on the loaded frame for exact results. Rows are
+ * compared by hash only.
+ *
+ * Quantile sketches: when 'opts->sketchK' is positive, every value of every kept row is added to a
+ * quantile sketch of its column, stored in the 'sketches' member, so that approximate percentiles of
+ * files too large to sort can be read with 'csvQuantile()'. Larger 'sketchK' gives more accurate
+ * quantiles; 200 keeps the rank error around one percent.
+ *
+ * Distinct counts: when 'opts->distinctCounts' is TRUE, the raw bytes of every field, rather than its
+ * converted value, are hashed once its row is kept and fed into a HyperLogLog sketch of its column
+ * stored in the 'hll' member; 'csvDistinctCount()' turns it into an estimate. Trailing line breaks are
+ * not part of a field. Lookup columns are hashed from their values. Rows dropped as duplicates or left
+ * out of the sample do not change the estimates.
+ *
+ * Column types: 'opts->colTypes' gives the type of every file column, see 'csvType_t'; without it
+ * every column is CSV_FLOAT. One converter function per column is picked before the first row is
+ * read, so the row loop calls through a table instead of deciding the type of every field.
+ * CSV_FLOAT parses plain decimals directly and falls back to 'strtod()' for exponents, very long
+ * mantissas and special values, giving the same result as 'atof()'. CSV_INT truncates like
+ * 'strtol()'. CSV_SKIP stores NaN without reading the field. The first data record sets the number
+ * of file columns; later records with fewer fields get NaN for the missing ones.
+ *
+ * Hashed categorical columns: the fields of the file columns listed in 'opts->hashCols', or typed
+ * CSV_HASHED, are not converted; the hash of their raw bytes modulo 'opts->hashBuckets' is stored
+ * instead. Text categories thus become bucket codes without the strings ever being kept, ready for
+ * 'csvEncode()' or 'csvEncodeSparse()'. Different categories may share a bucket. 'opts->hashBuckets'
+ * must be positive whenever a column is hashed, either way, or the load fails.
+ *
+ * Statistics: when the library is compiled with CSV_ENABLE_STATS and 'opts->stats' is not NULL, the
+ * load fills it with its counters, see 'csvStats_t'. Stage times are measured on one record in
+ * CSV_STATS_SAMPLE and scaled up; time spent on deduplication, lookups and sketches is in the totals
+ * only. On Linux the hardware counters of the whole load are read through 'perf_event_open()' when
+ * the kernel allows it. Without CSV_ENABLE_STATS the struct is zeroed and no clock is read.
+ *
+ * Tracing: when 'opts->tracer' is not NULL, the load records spans for opening the file, the sizing
+ * pass, setup, every block of CSV_TRACE_ROWS records, the whole parse, the final summaries and the
+ * whole load, ready for 'csvTraceDump()'. Records are parsed one after the other, reading, scanning
+ * and converting every line in turn, so a block span covers all three.
+ *
+ * Sampling: 'opts->sampleMode' keeps a uniform random sample of the rows, drawn with 'opts->seed'.
+ * CSV_SAMPLE_RESERVOIR keeps exactly 'opts->sampleRows' rows (or every row of a smaller file),
+ * CSV_SAMPLE_BERNOULLI keeps each row with probability 'opts->sampleFraction', and CSV_SAMPLE_BLOCK
+ * keeps whole runs of 'opts->sampleBlockRows' consecutive rows with that probability, which is
+ * cheaper but less uniform. Records are accepted or skipped before they are tokenised, so skipped
+ * records cost only the line read. Every other option, including zone maps, sketches and distinct
+ * counts, describes the sample. Reservoir samples are not in file order. As reservoir rows can be
+ * replaced until the last record, the distinct counts of a reservoir sample are computed from the
+ * values of the final rows, like lookup columns, so fields spelling one value differently count once.
+ * Deduplication runs before sampling: with CSV_SAMPLE_RESERVOIR its window holds the candidates
+ * drawn for the reservoir, including those replaced later, so it is best combined with the
+ * other modes or with 'csvDedup()' on the sample.
+ *
+ * @param filePtr A pointer to the '.csv' file to load data from.
+ * @param opts A pointer to the load options, or NULL.
+ * @return A pointer to a dynamically allocated 'csvData_t' structure representing the loaded data frame,
+ *         or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *regions = loadRegions();   // lookup frame: region id, latitude, longitude
+ *   csvLookup_t lookup = {regions, 2, 0}; // match column 2 of the file with column 0 of 'regions'
+ *   csvLoadOpts_t opts = {0};
+ *   opts.lookups = &lookup;
+ *   opts.nLookups = 1;
+ *   csvData_t *dataFrame = loadCsvWith(NULL, &opts);
+ *   if (dataFrame != NULL)
+ *   {
+ *       // Every row now ends with the latitude and longitude of its region...
+ *       freeDataFrame(dataFrame);
+ *   }
+ * @endcode
+ */
+csvData_t *loadCsvWith(FILE *filePtr, const csvLoadOpts_t *opts)
+{
+    char buffer[1024];
+    char *save;
+    csvLoadOpts_t none = {0};
+    statsTimer_t timer = {0}, total = {0};
+
+    if(opts == NULL)
+    {
+        opts = &none;
+    }
+
+    if(opts->stats != NULL)
+    {
+        memset(opts->stats, 0, sizeof(csvStats_t)); //stays zeroed without CSV_ENABLE_STATS
+    }
+#ifdef CSV_ENABLE_STATS
+    csvStats_t *stats = opts->stats;
+#else
+    csvStats_t *stats = NULL;
+#endif
+
+    if((opts->sampleMode == CSV_SAMPLE_RESERVOIR && opts->sampleRows < 0) ||
+       (opts->sampleMode == CSV_SAMPLE_BLOCK && opts->sampleBlockRows <= 0))
+    {
+        puts("Invalid sampling options.");
+        return NULL;
+    }
+
+    for(int col=0; col<opts->nHashCols; col++)
+    {
+        if(opts->hashCols == NULL || opts->hashCols[col] < 0 || opts->hashBuckets <= 0)
+        {
+            puts("Invalid hashed columns.");
+            return NULL;
+        }
+    }
+
+    for(int col=0; col<opts->nDedupCols; col++)
+    {
+        if(opts->dedupCols == NULL || opts->dedupCols[col] < 0)
+        {
+            puts("Invalid deduplication columns.");
+            return NULL;
+        }
+    }
+
+    for(int lookup=0; lookup<opts->nLookups; lookup++) //validate lookups before touching the file
+    {
+        const csvLookup_t *lk = &opts->lookups[lookup];
+        if(lk->table == NULL || lk->table->dataFrame == NULL || lk->keyCol < 0 ||
+           lk->tableKeyCol < 0 || lk->tableKeyCol >= lk->table->cols)
+        {
+            puts("Invalid lookup table.");
+            return NULL;
+        }
+    }
+
+    STATS_CALIBRATE(stats, timer);
+    STATS_COUNTERS(stats, total);
+    STATS_START(stats, total, 1, 1.0);
+    STATS_START(stats, timer, 1, 1.0);
+    csvTracer_t *tracer = opts->tracer;
+    double loadSpan = traceBegin(tracer), span = loadSpan;
+
+    const char *path = opts->path != NULL ? opts->path : CSV_PATH;
+    filePtr = fopen(path, CSV_MODE);
+
+    if(filePtr != NULL)
+    {
+        puts("the file has been opened\n");
+    }
+    else
+    {
+        puts("Could not open the file.");
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+
+    STATS_STAGE(stats, timer, CSV_STAGE_IO);
+    traceEnd(tracer, "open", span, -1, -1);
+    span = traceBegin(tracer);
+
+    csvData_t *df = frameForFile(path); //create and initialize dataframe
+    if(df == NULL)
+    {
+        fclose(filePtr);
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+    int fileCols = df->cols;
+    if(hashTypesValid(opts, fileCols) != TRUE)
+    {
+        puts("Invalid hashed columns.");
+        fclose(filePtr);
+        freeDataFrame(df);
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+    STATS_HOLD(stats, sizeof(csvData_t) + 1024 + strlen(CSV_DELIM) + 1);
+    STATS_STAGE(stats, timer, CSV_STAGE_SCAN); //the sizing pass
+    traceEnd(tracer, "size", span, df->rows, -1);
+    span = traceBegin(tracer);
+
+    //PREPARE LOOKUPS ---------------------------------------------------------
+
+    keyIndex_t *lookupIdx = (keyIndex_t *)calloc(opts->nLookups + 1, sizeof(keyIndex_t));
+    for(int lookup=0; lookup<opts->nLookups; lookup++)
+    {
+        const csvLookup_t *lk = &opts->lookups[lookup];
+        const csvData_t *table = lk->table;
+
+        if(lk->keyCol >= fileCols ||
+           keyIndexInit(&lookupIdx[lookup], table->rows, table->dataFrame, &lk->tableKeyCol, 1) != TRUE)
+        {
+            puts("Invalid lookup table.");
+            for(int built=0; built<lookup; built++)
+            {
+                keyIndexFree(&lookupIdx[built]);
+            }
+            free(lookupIdx);
+            fclose(filePtr);
+            freeDataFrame(df);
+            STATS_TOTAL(stats, total);
+            return NULL;
+        }
+
+        bool_t ok = TRUE;
+        for(int row=0; ok == TRUE && row<table->rows; row++)
+        {
+            uint64_t hash = hashKeys(table->dataFrame[row], &lk->tableKeyCol, 1);
+            if(keyIndexFind(&lookupIdx[lookup], hash, table->dataFrame[row], &lk->tableKeyCol) < 0)
+            {
+                ok = keyIndexInsert(&lookupIdx[lookup], hash, row);
+            }
+        }
+        if(ok != TRUE) //a missing key would silently turn matches into NaN
+        {
+            puts("Could not index lookup table.");
+            for(int built=0; built<=lookup; built++)
+            {
+                keyIndexFree(&lookupIdx[built]);
+            }
+            free(lookupIdx);
+            fclose(filePtr);
+            freeDataFrame(df);
+            STATS_TOTAL(stats, total);
+            return NULL;
+        }
+        df->cols += table->cols - 1;
+        STATS_HOLD(stats, sizeof(keySlot_t) * (lookupIdx[lookup].mask + 1));
+    }
+
+    //PREPARE DEDUPLICATION ---------------------------------------------------
+
+    int *dedupCols = NULL, nDedupCols = 0;
+    uint64_t *seen = NULL, *window = NULL; //hash set and the ring of its hashes, oldest first
+    size_t seenMask = 0, seenCount = 0, windowNext = 0;
+
+    if(opts->dedupCapacity > 0)
+    {
+        size_t size = 16;
+        while(size < (size_t)opts->dedupCapacity * 2)
+        {
+            size <<= 1;
+        }
+        seen = (uint64_t *)calloc(size + opts->dedupCapacity, sizeof(uint64_t)); //0 marks an empty slot
+        window = seen != NULL ? seen + size : NULL;
+        seenMask = size - 1;
+        STATS_HOLD(stats, sizeof(uint64_t) * (size + opts->dedupCapacity));
+
+        nDedupCols = opts->dedupCols != NULL ? opts->nDedupCols : fileCols;
+        dedupCols = (int *)malloc(sizeof(int) * (nDedupCols + 1));
+
+        for(int col=0; col<nDedupCols && dedupCols != NULL; col++)
+        {
+            dedupCols[col] = opts->dedupCols != NULL ? opts->dedupCols[col] : col;
+            if(dedupCols[col] >= fileCols)
+            {
+                free(dedupCols);
+                dedupCols = NULL;
+            }
+        }
+
+        if(seen == NULL || dedupCols == NULL)
+        {
+            puts("Invalid deduplication columns.");
+            for(int lookup=0; lookup<opts->nLookups; lookup++)
+            {
+                keyIndexFree(&lookupIdx[lookup]);
+            }
+            free(lookupIdx);
+            free(seen);
+            free(dedupCols);
+            fclose(filePtr);
+            freeDataFrame(df);
+            STATS_TOTAL(stats, total);
+            return NULL;
+        }
+    }
+
+    //PREPARE QUANTILE SKETCHES -----------------------------------------------
+
+    if(opts->sketchK > 0)
+    {
+        df->sketches = (csvSketch_t **)calloc(df->cols + 1, sizeof(csvSketch_t *));
+        for(int col=0; col<df->cols && df->sketches != NULL; col++)
+        {
+            df->sketches[col] = csvSketchCreate(opts->sketchK);
+        }
+    }
+
+    //PREPARE CONVERTERS ------------------------------------------------------
+
+    converter_t *convert = (converter_t *)malloc(sizeof(converter_t) * (fileCols + 1)); //chosen once per load
+    char **fields = (char **)malloc(sizeof(char *) * (fileCols + 1)); //fields of the current record
+    convertCtx_t ctx = {(uint64_t)opts->hashBuckets, 0}; //only read by CSV_HASHED columns, which need buckets
+
+    for(int col=0; convert != NULL && col<fileCols; col++)
+    {
+        csvType_t type = opts->colTypes != NULL ? opts->colTypes[col] : CSV_FLOAT;
+        for(int hashCol=0; hashCol<opts->nHashCols; hashCol++)
+        {
+            type = opts->hashCols[hashCol] == col ? CSV_HASHED : type;
+        }
+        convert[col] = converterFor(type);
+    }
+    if(convert == NULL || fields == NULL)
+    {
+        puts("Could not allocate the converters.");
+        free(convert);
+        free(fields);
+        for(int lookup=0; lookup<opts->nLookups; lookup++)
+        {
+            keyIndexFree(&lookupIdx[lookup]);
+        }
+        free(lookupIdx);
+        free(seen);
+        free(dedupCols);
+        fclose(filePtr);
+        freeDataFrame(df);
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+
+    if(opts->distinctCounts == TRUE)
+    {
+        df->hll = (unsigned char *)calloc(((size_t)df->cols << CSV_HLL_BITS) + 1, sizeof(unsigned char));
+        STATS_HOLD(stats, ((size_t)df->cols << CSV_HLL_BITS) + 1);
+    }
+    STATS_HOLD(stats, (sizeof(converter_t) + sizeof(char *)) * (fileCols + 1));
+    STATS_STAGE(stats, timer, CSV_STAGE_ALLOC);
+
+    //EXTRACT FEATURE NAMES ---------------------------------------------------
+
+    {
+        if(fgets(buffer, 1024, filePtr) == NULL) //get the first line of csv file, an empty file has none
+        {
+            buffer[0] = '\0';
+        }
+        char *tokens = splitToken(buffer, df->delim, &save);   //split into multiple tokens
+
+        while(tokens) //
+        {
+            char *label = trimToken(tokens); //trim token of unwanted characters
+            if(label == NULL)
+            {
+                puts("Could not allocate the feature names.");
+                for(int lookup=0; lookup<opts->nLookups; lookup++)
+                {
+                    keyIndexFree(&lookupIdx[lookup]);
+                }
+                free(lookupIdx);
+                free(seen);
+                free(dedupCols);
+                free(convert);
+                free(fields);
+                fclose(filePtr);
+                freeDataFrame(df);
+                STATS_TOTAL(stats, total);
+                return NULL;
+            }
+            strcat(df->params, label); //write into dataframe
+            printf("\"%s\", \n", label); //print dataset features, can be commented out
+            free(label);
+            tokens = splitToken(NULL, df->delim, &save); //split the next token from source
+        }
+    }
+    STATS_STAGE(stats, timer, CSV_STAGE_IO);
+
+    //EXTRACT DATA POINTS------------------------------------------------------
+
+    int reservoir = opts->sampleMode == CSV_SAMPLE_RESERVOIR;
+    if(reservoir && opts->sampleRows < df->rows)
+    {
+        df->rows = opts->sampleRows + 1; //the extra row receives candidates before they replace a kept row
+    }
+
+    df->dataFrame = (float **)calloc(df->rows + 1, sizeof(float *)); //rows are allocated as they are first filled
+    if(df->dataFrame == NULL)
+    {
+        puts("Could not allocate the data frame.");
+        for(int lookup=0; lookup<opts->nLookups; lookup++)
+        {
+            keyIndexFree(&lookupIdx[lookup]);
+        }
+        free(lookupIdx);
+        free(seen);
+        free(dedupCols);
+        free(convert);
+        free(fields);
+        fclose(filePtr);
+        freeDataFrame(df);
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+
+    zoneMapInit(df, CSV_ZONE_ROWS); //block statistics are recorded while rows are parsed
+    STATS_HOLD(stats, sizeof(float *) * (df->rows + 1) + sizeof(csvZoneMap_t) +
+               (sizeof(float) * 2 + sizeof(int)) * ((size_t)(df->rows / CSV_ZONE_ROWS + 1) * df->cols + 1));
+    STATS_STAGE(stats, timer, CSV_STAGE_ALLOC);
+    traceEnd(tracer, "setup", span, -1, -1);
+
+    {
+        int row = 0, keepBlock = 0;
+        long record = -1;
+        uint64_t rng = opts->seed;
+        double parseSpan = traceBegin(tracer);
+        long long blockBytes = tracer != NULL ? ftell(filePtr) : 0, parseBytes = blockBytes;
+
+        span = parseSpan;
+        for(;;) //get data from dataset row by row
+        {
+            if(tracer != NULL && record >= 0 && (record + 1) % CSV_TRACE_ROWS == 0) //close the traced block
+            {
+                long long at = ftell(filePtr);
+                traceEnd(tracer, "block", span, CSV_TRACE_ROWS, at - blockBytes);
+                blockBytes = at;
+                span = traceBegin(tracer);
+            }
+            STATS_START(stats, timer, (record + 1) % CSV_STATS_SAMPLE == 0, CSV_STATS_SAMPLE);
+            if(fgets(buffer, 1024, filePtr) == NULL)
+            {
+                break;
+            }
+            STATS_STAGE(stats, timer, CSV_STAGE_IO);
+
+            int col = 0, nFields = 0, slot = row, replace = -1;
+            record++;
+
+            switch(opts->sampleMode) //decide before tokenising, skipped records cost one line read
+            {
+                case CSV_SAMPLE_BERNOULLI:
+                    if((nextRandom(&rng) >> 11) * 0x1.0p-53 >= opts->sampleFraction)
+                    {
+                        continue;
+                    }
+                    break;
+                case CSV_SAMPLE_BLOCK:
+                    if(record % opts->sampleBlockRows == 0)
+                    {
+                        keepBlock = (nextRandom(&rng) >> 11) * 0x1.0p-53 < opts->sampleFraction;
+                    }
+                    if( ! keepBlock)
+                    {
+                        continue;
+                    }
+                    break;
+                case CSV_SAMPLE_RESERVOIR:
+                    if(row >= opts->sampleRows) //reservoir is full, replace a random row with probability N / (record + 1)
+                    {
+                        replace = (int)(nextRandom(&rng) % (uint64_t)(record + 1));
+                        if(replace >= opts->sampleRows)
+                        {
+                            continue;
+                        }
+                        slot = opts->sampleRows;
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            if(slot >= df->rows) //more lines than counted before
+            {
+                break;
+            }
+            if(df->dataFrame[slot] == NULL)
+            {
+                df->dataFrame[slot] = (float *)malloc(sizeof(float) * df->cols);
+                if(df->dataFrame[slot] == NULL && df->cols > 0)
+                {
+                    puts("Could not allocate the data frame.");
+                for(int lookup=0; lookup<opts->nLookups; lookup++)
+                {
+                    keyIndexFree(&lookupIdx[lookup]);
+                }
+                free(lookupIdx);
+                free(seen);
+                free(dedupCols);
+                free(convert);
+                free(fields);
+                fclose(filePtr);
+                freeDataFrame(df);
+                STATS_TOTAL(stats, total);
+                return NULL;
+                }
+                STATS_HOLD(stats, sizeof(float) * df->cols);
+                STATS_STAGE(stats, timer, CSV_STAGE_ALLOC);
+            }
+
+            char *tokens = splitToken(buffer, df->delim, &save); //split into tokens
+
+            while(tokens && nFields < fileCols)
+            {
+                fields[nFields++] = tokens;
+                tokens = splitToken(NULL, df->delim, &save); //further break into tokens
+            }
+            STATS_COUNT(stats, fields, nFields);
+            STATS_STAGE(stats, timer, CSV_STAGE_SCAN);
+
+            for(col=0; col<nFields; col++)
+            {
+                df->dataFrame[slot][col] = convert[col](fields[col], &ctx); //feed data into dataframe
+            }
+            for(; col<fileCols; col++) //short record, its missing fields are unknown
+            {
+                df->dataFrame[slot][col] = NAN;
+            }
+            STATS_STAGE(stats, timer, CSV_STAGE_CONVERT);
+            //(void)puts(" ");
+
+            if(seen != NULL) //streaming deduplication
+            {
+                uint64_t hash = hashKeys(df->dataFrame[slot], dedupCols, nDedupCols) | 1;
+                size_t bucket = hash & seenMask;
+
+                while(seen[bucket] != 0 && seen[bucket] != hash)
+                {
+                    bucket = (bucket + 1) & seenMask;
+                }
+                if(seen[bucket] == hash)
+                {
+                    continue; //duplicate, the next row reuses this row's memory
+                }
+                if(seenCount == (size_t)opts->dedupCapacity) //window is full, forget its oldest row
+                {
+                    seenRemove(seen, seenMask, window[windowNext]);
+                    seenCount--;
+                    bucket = hash & seenMask; //the removal may have moved entries
+                    while(seen[bucket] != 0)
+                    {
+                        bucket = (bucket + 1) & seenMask;
+                    }
+                }
+                seen[bucket] = hash;
+                seenCount++;
+                window[windowNext] = hash;
+                windowNext = (windowNext + 1) % (size_t)opts->dedupCapacity;
+            }
+
+            col = fileCols;
+            for(int lookup=0; lookup<opts->nLookups; lookup++) //enrich the row from the lookup frames
+            {
+                const csvLookup_t *lk = &opts->lookups[lookup];
+                const csvData_t *table = lk->table;
+                uint64_t hash = hashKeys(df->dataFrame[slot], &lk->keyCol, 1);
+                int match = keyIndexFind(&lookupIdx[lookup], hash, df->dataFrame[slot], &lk->keyCol);
+
+                for(int tableCol=0; tableCol<table->cols; tableCol++)
+                {
+                    if(tableCol != lk->tableKeyCol)
+                    {
+                        df->dataFrame[slot][col++] = match >= 0 ? table->dataFrame[match][tableCol] : NAN;
+                    }
+                }
+            }
+            for(col=0; df->hll != NULL && ! reservoir && col<nFields; col++) //the row is kept, count its raw fields
+            {
+                hllAdd(df->hll + ((size_t)col << CSV_HLL_BITS), hashBytes(fields[col], fieldLength(fields[col])));
+            }
+            for(col=fileCols; df->hll != NULL && ! reservoir && col<df->cols; col++) //lookup columns have no raw bytes
+            {
+                hllAdd(df->hll + ((size_t)col << CSV_HLL_BITS), hashBytes(&df->dataFrame[slot][col], sizeof(float)));
+            }
+
+            if(replace >= 0) //commit the candidate in place of a reservoir row
+            {
+                float *swap = df->dataFrame[replace];
+                df->dataFrame[replace] = df->dataFrame[slot];
+                df->dataFrame[slot] = swap;
+                continue;
+            }
+
+            if( ! reservoir)
+            {
+                zoneMapUpdate(df->zoneMap, row, df->dataFrame[slot]);
+                for(int sketch=0; df->sketches != NULL && sketch<df->cols; sketch++)
+                {
+                    csvSketchAdd(df->sketches[sketch], df->dataFrame[slot][sketch]);
+                }
+            }
+            row++;
+        }
+
+        for(int spare=row; stats != NULL && spare<df->rows; spare++)
+        {
+            STATS_HOLD(stats, df->dataFrame[spare] != NULL ? -(long long)(sizeof(float) * df->cols) : 0);
+        }
+        if(tracer != NULL && (record + 1) % CSV_TRACE_ROWS != 0)
+        {
+            traceEnd(tracer, "block", span, (record + 1) % CSV_TRACE_ROWS, ftell(filePtr) - blockBytes);
+        }
+        traceEnd(tracer, "parse", parseSpan, record + 1, tracer != NULL ? ftell(filePtr) - parseBytes : -1);
+        span = traceBegin(tracer);
+
+        trimRows(df, row); //release the rows left over by dropped or skipped records
+        STATS_COUNT(stats, records, record + 1);
+        STATS_COUNT(stats, bytes, ftell(filePtr));
+        STATS_COUNT(stats, fallbacks, ctx.fallbacks);
+
+        if(reservoir) //kept rows were replaced along the way, summarise the final sample only
+        {
+            csvBuildZoneMap(df, CSV_ZONE_ROWS);
+            for(int kept=0; kept<df->rows; kept++)
+            {
+                for(int sketch=0; df->sketches != NULL && sketch<df->cols; sketch++)
+                {
+                    csvSketchAdd(df->sketches[sketch], df->dataFrame[kept][sketch]);
+                }
+                for(int col=0; df->hll != NULL && col<df->cols; col++) //raw bytes are gone, hash the values
+                {
+                    hllAdd(df->hll + ((size_t)col << CSV_HLL_BITS), hashBytes(&df->dataFrame[kept][col], sizeof(float)));
+                }
+            }
+        }
+        traceEnd(tracer, "finish", span, df->rows, -1);
+    }
+
+    for(int lookup=0; lookup<opts->nLookups; lookup++)
+    {
+        STATS_HOLD(stats, -(long long)(sizeof(keySlot_t) * (lookupIdx[lookup].mask + 1)));
+        keyIndexFree(&lookupIdx[lookup]);
+    }
+    STATS_HOLD(stats, -(long long)((sizeof(converter_t) + sizeof(char *)) * (fileCols + 1) +
+                                   (seen != NULL ? sizeof(uint64_t) * (seenMask + 1 + opts->dedupCapacity) : 0)));
+    free(lookupIdx);
+    free(seen);
+    free(dedupCols);
+    free(convert);
+    free(fields);
+
+    fclose(filePtr);
+    STATS_TOTAL(stats, total);
+    traceEnd(tracer, "load", loadSpan, df->rows, -1);
+
+    return df;
+}
+
+static void jsonCount(FILE *out, const char *name, long long count, const char *sep)
+{
+    if(count < 0)
+    {
+        fprintf(out, "\"%s\":null%s", name, sep);
+    }
+    else
+    {
+        fprintf(out, "\"%s\":%lld%s", name, count, sep);
+    }
+}
+
+static void jsonRatio(FILE *out, const char *name, long long count, double per, const char *sep)
+{
+    if(count < 0 || per <= 0.0)
+    {
+        fprintf(out, "\"%s\":null%s", name, sep);
+    }
+    else
+    {
+        fprintf(out, "\"%s\":%.6g%s", name, (double)count / per, sep);
+    }
+}
+
+/**
+ * @brief Write the statistics of a load as one line of JSON.
+ *
+ * Next to the raw counters of 'csvStats_t', the object holds the ratios used to compare loader
+ * variants: cycles and instructions per byte, and branch, L1D, LLC and dTLB misses per KiB parsed.
+ * Counters that could not be read are written as null. One object per line lets benchmark runs
+ * be appended to a single file and read back as JSON Lines.
+ *
+ * @param stats The statistics filled by a load, see 'csvLoadOpts_t'.
+ * @param label A name for the run, for example the loader variant and file, or NULL.
+ * @param out The stream written to.
+ * @return TRUE on success, FALSE if an argument is NULL or writing failed.
+ *
+ * @code
+ *   // Example usage:
+ *   csvStats_t stats;
+ *   csvLoadOpts_t opts = {0};
+ *   opts.stats = &stats;
+ *   csvData_t *dataFrame = loadCsvWith(NULL, &opts);
+ *   csvStatsToJson(&stats, "default", stdout);
+ *   // {"label":"default","bytes":3955583,...,"cycles_per_byte":21.3,...}
+ *   freeDataFrame(dataFrame);
+ * @endcode
+ */
+bool_t csvStatsToJson(const csvStats_t *stats, const char *label, FILE *out)
+{
+    static const char *stages[CSV_STAGES] = {"io", "scan", "convert", "alloc"};
+
+    if(stats == NULL || out == NULL)
+    {
+        return FALSE;
+    }
+
+    double bytes = (double)stats->bytes, kib = bytes / 1024.0;
+
+    fputs("{\"label\":\"", out);
+    for(const char *at = label != NULL ? label : ""; *at; at++) //escape the label as a JSON string
+    {
+        if(*at == '"' || *at == '\\')
+        {
+            fprintf(out, "\\%c", *at);
+        }
+        else if((unsigned char)*at < 0x20)
+        {
+            fprintf(out, "\\u%04x", (unsigned char)*at);
+        }
+        else
+        {
+            fputc(*at, out);
+        }
+    }
+    fputs("\",", out);
+
+    fprintf(out, "\"bytes\":%lld,\"records\":%ld,\"fields\":%lld,\"fallbacks\":%ld,",
+            stats->bytes, stats->records, stats->fields, stats->fallbacks);
+    fprintf(out, "\"bytes_held\":%lu,\"peak_bytes\":%lu,\"wall_s\":%.9g,\"cpu_s\":%.9g,\"stages\":{",
+            (unsigned long)stats->bytesHeld, (unsigned long)stats->peakBytes, stats->totalWall, stats->totalCpu);
+    for(int stage=0; stage<CSV_STAGES; stage++)
+    {
+        fprintf(out, "\"%s\":{\"wall_s\":%.9g,\"cpu_s\":%.9g}%s", stages[stage], stats->wall[stage],
+                stats->cpu[stage], stage + 1 < CSV_STAGES ? "," : "},");
+    }
+
+    jsonCount(out, "cycles", stats->counters[CSV_CYCLES], ",");
+    jsonCount(out, "instructions", stats->counters[CSV_INSTRUCTIONS], ",");
+    jsonCount(out, "branch_misses", stats->counters[CSV_BRANCH_MISSES], ",");
+    jsonCount(out, "l1d_misses", stats->counters[CSV_L1D_MISSES], ",");
+    jsonCount(out, "llc_misses", stats->counters[CSV_LLC_MISSES], ",");
+    jsonCount(out, "dtlb_misses", stats->counters[CSV_DTLB_MISSES], ",");
+    jsonRatio(out, "cycles_per_byte", stats->counters[CSV_CYCLES], bytes, ",");
+    jsonRatio(out, "instructions_per_byte", stats->counters[CSV_INSTRUCTIONS], bytes, ",");
+    jsonRatio(out, "branch_misses_per_kib", stats->counters[CSV_BRANCH_MISSES], kib, ",");
+    jsonRatio(out, "l1d_misses_per_kib", stats->counters[CSV_L1D_MISSES], kib, ",");
+    jsonRatio(out, "llc_misses_per_kib", stats->counters[CSV_LLC_MISSES], kib, ",");
+    jsonRatio(out, "dtlb_misses_per_kib", stats->counters[CSV_DTLB_MISSES], kib, "}\n");
+
+    return ferror(out) ? FALSE : TRUE;
+}
+
+/**
+ * @brief Create a tracer recording the stages of the loads it is passed to, see 'csvLoadOpts_t'.
+ *
+ * A tracer is a ring of the last 'capacity' spans. It takes no lock: each thread that loads files
+ * gets its own tracer, and the tracers of all threads are dumped together once the loads are done.
+ *
+ * @param capacity The number of spans kept, at least 1.
+ * @param tid The thread id shown for these spans in the trace viewer.
+ * @return A pointer to a dynamically allocated tracer, or NULL if 'capacity' is invalid or memory
+ *         could not be allocated.
+ *
+ * @note The caller is responsible for releasing the tracer with 'csvTracerFree()'.
+ */
+csvTracer_t *csvTracerCreate(int capacity, int tid)
+{
+    if(capacity <= 0)
+    {
+        return NULL;
+    }
+
+    csvTracer_t *tracer = (csvTracer_t *)malloc(sizeof(csvTracer_t));
+    if(tracer == NULL)
+    {
+        return NULL;
+    }
+
+    tracer->events = (csvTraceEvent_t *)malloc(sizeof(csvTraceEvent_t) * capacity);
+    if(tracer->events == NULL)
+    {
+        free(tracer);
+        return NULL;
+    }
+    tracer->capacity = capacity;
+    tracer->count = 0;
+    tracer->tid = tid;
+
+    return tracer;
+}
+
+/**
+ * @brief Release a tracer. Passing NULL is allowed and does nothing.
+ */
+void csvTracerFree(csvTracer_t *tracer)
+{
+    if(tracer == NULL)
+    {
+        return;
+    }
+
+    free(tracer->events);
+    free(tracer);
+}
+
+/**
+ * @brief Write the spans of one or more tracers as a Chrome trace event file.
+ *
+ * Every span becomes a complete ("X") event on the thread of its tracer, with its record and byte
+ * counts as arguments. The output opens in chrome://tracing or Perfetto, where the spans of
+ * concurrent loads line up on a shared timeline and nested stages stack under the load.
+ *
+ * @param tracers The tracers to dump, NULL entries are skipped.
+ * @param nTracers The number of tracers.
+ * @param out The stream written to.
+ * @return TRUE on success, FALSE if an argument is invalid or writing failed.
+ *
+ * @code
+ *   // Example usage:
+ *   csvTracer_t *tracer = csvTracerCreate(4096, 1);
+ *   csvLoadOpts_t opts = {0};
+ *   opts.tracer = tracer;
+ *   csvData_t *dataFrame = loadCsvWith(NULL, &opts);
+ *   FILE *trace = fopen("load_trace.json", "w");
+ *   csvTraceDump(&tracer, 1, trace);
+ *   fclose(trace);
+ *   csvTracerFree(tracer);
+ *   freeDataFrame(dataFrame);
+ * @endcode
+ */
+bool_t csvTraceDump(csvTracer_t *const *tracers, int nTracers, FILE *out)
+{
+    const char *sep = "";
+
+    if(tracers == NULL || nTracers < 0 || out == NULL)
+    {
+        return FALSE;
+    }
+
+    fputs("{\"traceEvents\":[", out);
+    for(int index=0; index<nTracers; index++)
+    {
+        const csvTracer_t *tracer = tracers[index];
+        if(tracer == NULL)
+        {
+            continue;
+        }
+
+        long long first = tracer->count > tracer->capacity ? tracer->count - tracer->capacity : 0;
+        for(long long at=first; at<tracer->count; at++) //oldest span first
+        {
+            const csvTraceEvent_t *event = &tracer->events[at % tracer->capacity];
+
+            fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"open_csv\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                    "\"pid\":1,\"tid\":%d,\"args\":{", sep, event->name, event->start, event->duration, tracer->tid);
+            jsonCount(out, "records", event->records, ",");
+            jsonCount(out, "bytes", event->bytes, "}}");
+            sep = ",";
+        }
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", out);
+
+    return ferror(out) ? FALSE : TRUE;
+}
+
+/**
+ * @brief Create an empty mergeable quantile sketch.
+ *
+ * The sketch keeps a stack of levels of at most 'k' values each. New values go to level 0; when a
+ * level fills up, it is sorted and every other value, starting at a random offset, is promoted to the
+ * next level where it stands for twice as many inputs, the rest being dropped. Memory grows with
+ * k * log2(n / k), and the rank error of a quantile is in the order of log2(n / k) / k.
+ *
+ * @param k The number of values per level, rounded up to an even number of at least 8.
+ * @return A pointer to a dynamically allocated sketch, or NULL if memory could not be allocated.
+ *
+ * @note The caller is responsible for releasing the sketch with 'csvSketchFree()'.
+ *
+ * @code
+ *   // Example usage:
+ *   csvSketch_t *sketch = csvSketchCreate(200);
+ *   for (int row = 0; row < dataFrame->rows; row++)
+ *   {
+ *       csvSketchAdd(sketch, dataFrame->dataFrame[row][0]);
+ *   }
+ *   printf("p99: %f\n", csvSketchQuantile(sketch, 0.99));
+ *   csvSketchFree(sketch);
+ * @endcode
+ */
+csvSketch_t *csvSketchCreate(int k)
+{
+    csvSketch_t *sketch = (csvSketch_t *)calloc(1, sizeof(csvSketch_t));
+    if(sketch == NULL)
+    {
+        return NULL;
+    }
+
+    sketch->k = k < 8 ? 8 : k + (k & 1);
+    sketch->rng = 0x853C49E6748FEA9Bull;
+
+    return sketch;
+}
+
+/**
+ * @brief Release a quantile sketch. Passing NULL is allowed and does nothing.
+ */
+void csvSketchFree(csvSketch_t *sketch)
+{
+    if(sketch == NULL)
+    {
+        return;
+    }
+
+    for(int level=0; level<sketch->levels; level++)
+    {
+        free(sketch->items[level]);
+    }
+    free(sketch->items);
+    free(sketch->len);
+    free(sketch);
+}
+
+static int compareFloat(const void *a, const void *b)
+{
+    float x = *(const float *)a, y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Put a value on a level of a sketch, compacting the level into the next one when it fills up.
+ */
+static bool_t sketchPush(csvSketch_t *sketch, int level, float value)
+{
+    while(level >= sketch->levels) //open the missing levels
+    {
+        int fresh = sketch->levels;
+        int *len = (int *)realloc(sketch->len, sizeof(int) * (fresh + 1));
+        if(len == NULL)
+        {
+            return FALSE;
+        }
+        sketch->len = len;
+
+        float **items = (float **)realloc(sketch->items, sizeof(float *) * (fresh + 1));
+        if(items == NULL)
+        {
+            return FALSE;
+        }
+        sketch->items = items;
+
+        sketch->items[fresh] = (float *)malloc(sizeof(float) * sketch->k);
+        if(sketch->items[fresh] == NULL)
+        {
+            return FALSE;
+        }
+        sketch->len[fresh] = 0;
+        sketch->levels++;
+    }
+
+    sketch->items[level][sketch->len[level]++] = value;
+    if(sketch->len[level] < sketch->k)
+    {
+        return TRUE;
+    }
+
+    qsort(sketch->items[level], sketch->k, sizeof(float), compareFloat);
+
+    sketch->rng ^= sketch->rng << 13; //xorshift64, one bit per compaction
+    sketch->rng ^= sketch->rng >> 7;
+    sketch->rng ^= sketch->rng << 17;
+
+    sketch->len[level] = 0;
+    for(int item=(int)(sketch->rng & 1); item<sketch->k; item+=2)
+    {
+        if(sketchPush(sketch, level + 1, sketch->items[level][item]) != TRUE)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Add a value to a quantile sketch. NaN values are ignored.
+ *
+ * @param sketch A pointer to the sketch.
+ * @param value The value to add.
+ * @return TRUE on success, ERROR if 'sketch' is NULL, FALSE if memory could not be allocated.
+ */
+bool_t csvSketchAdd(csvSketch_t *sketch, float value)
+{
+    if(sketch == NULL)
+    {
+        return ERROR;
+    }
+    if(isnan(value))
+    {
+        return TRUE;
+    }
+
+    sketch->n++;
+
+    return sketchPush(sketch, 0, value);
+}
+
+/**
+ * @brief Merge a quantile sketch into another one.
+ *
+ * After the merge, 'dst' summarises the values of both sketches; 'src' is left unchanged. Sketches
+ * filled from separate parts of the data, for instance from separately loaded files, can be merged
+ * in any order. The two sketches must be distinct, a sketch cannot be merged into itself.
+ *
+ * @param dst A pointer to the sketch receiving the values.
+ * @param src A pointer to the sketch to merge, other than 'dst'.
+ * @return TRUE on success, ERROR if an argument is NULL or both are the same sketch, FALSE if memory
+ *         could not be allocated.
+ *
+ * @code
+ *   // Example usage:
+ *   csvSketch_t *total = csvSketchCreate(200);
+ *   csvSketchMerge(total, january->sketches[0]);
+ *   csvSketchMerge(total, february->sketches[0]);
+ *   printf("median: %f\n", csvSketchQuantile(total, 0.5));
+ *   csvSketchFree(total);
+ * @endcode
+ */
+bool_t csvSketchMerge(csvSketch_t *dst, const csvSketch_t *src)
+{
+    if(dst == NULL || src == NULL || dst == src) //pushing into 'dst' would move the levels being read
+    {
+        return ERROR;
+    }
+
+    for(int level=0; level<src->levels; level++)
+    {
+        for(int item=0; item<src->len[level]; item++)
+        {
+            if(sketchPush(dst, level, src->items[level][item]) != TRUE)
+            {
+                return FALSE;
+            }
+        }
+    }
+    dst->n += src->n;
+
+    return TRUE;
+}
+
+typedef struct {
+    float value;
+    long weight;
+}weighted_t;
+
+static int compareWeighted(const void *a, const void *b)
+{
+    return compareFloat(&((const weighted_t *)a)->value, &((const weighted_t *)b)->value);
+}
+
+/**
+ * @brief Estimate a quantile from a sketch.
+ *
+ * @param sketch A pointer to the sketch.
+ * @param q The quantile to estimate, between 0 and 1, e.g. 0.99 for the 99th percentile.
+ * @return The estimated quantile, or NaN if the sketch is empty, NULL, or 'q' is out of range.
+ */
+float csvSketchQuantile(const csvSketch_t *sketch, double q)
+{
+    if(sketch == NULL || ! (q >= 0.0 && q <= 1.0))
+    {
+        return NAN;
+    }
+
+    size_t held = 0;
+    for(int level=0; level<sketch->levels; level++)
+    {
+        held += sketch->len[level];
+    }
+    if(held == 0)
+    {
+        return NAN;
+    }
+
+    weighted_t *all = (weighted_t *)malloc(sizeof(weighted_t) * held);
+    if(all == NULL)
+    {
+        return NAN;
+    }
+
+    size_t at = 0;
+    long total = 0;
+    for(int level=0; level<sketch->levels; level++)
+    {
+        for(int item=0; item<sketch->len[level]; item++)
+        {
+            all[at].value = sketch->items[level][item];
+            all[at].weight = 1L << level;
+            total += all[at].weight;
+            at++;
+        }
+    }
+    qsort(all, held, sizeof(weighted_t), compareWeighted);
+
+    double target = q * total;
+    long seen = 0;
+    float result = all[held - 1].value;
+    for(size_t item=0; item<held; item++)
+    {
+        seen += all[item].weight;
+        if(seen >= target)
+        {
+            result = all[item].value;
+            break;
+        }
+    }
+    free(all);
+
+    return result;
+}
+
+/**
+ * @brief Estimate a quantile of a column from the sketches recorded at load time.
+ *
+ * @param df A pointer to a data frame loaded with 'opts->sketchK' set, see 'loadCsvWith()'.
+ * @param col The column index.
+ * @param q The quantile to estimate, between 0 and 1.
+ * @return The estimated quantile, or NaN if the frame has no sketches or an argument is invalid.
+ *
+ * @code
+ *   // Example usage:
+ *   csvLoadOpts_t opts = {0};
+ *   opts.sketchK = 200;
+ *   csvData_t *dataFrame = loadCsvWith(NULL, &opts);
+ *   for (int col = 0; col < dataFrame->cols; col++)
+ *   {
+ *       printf("column %d: p50 %f, p95 %f, p99 %f\n", col, csvQuantile(dataFrame, col, 0.5),
+ *              csvQuantile(dataFrame, col, 0.95), csvQuantile(dataFrame, col, 0.99));
+ *   }
+ * @endcode
+ */
+float csvQuantile(const csvData_t *df, int col, double q)
+{
+    if(df == NULL || df->sketches == NULL || col < 0 || col >= df->cols)
+    {
+        return NAN;
+    }
+
+    return csvSketchQuantile(df->sketches[col], q);
+}
+
+/**
+ * @brief Estimate the number of distinct values of a column from its load time HyperLogLog sketch.
+ *
+ * The sketch is recorded by 'loadCsvWith()' with 'opts->distinctCounts' set, from the raw bytes of the
+ * fields; "1.0" and "1" therefore count as two values. With CSV_HLL_BITS at 12 the standard error
+ * is about 1.6 percent; small cardinalities are estimated by linear counting and are close to exact.
+ *
+ * @param df A pointer to the data frame.
+ * @param col The column index.
+ * @return The estimated number of distinct values, or -1 if the frame has no sketch or 'col' is invalid.
+ *
+ * @code
+ *   // Example usage:
+ *   csvLoadOpts_t opts = {0};
+ *   opts.distinctCounts = TRUE;
+ *   csvData_t *dataFrame = loadCsvWith(NULL, &opts);
+ *   for (int col = 0; col < dataFrame->cols; col++)
+ *   {
+ *       printf("column %d: ~%.0f distinct values\n", col, csvDistinctCount(dataFrame, col));
+ *   }
+ * @endcode
+ */
+double csvDistinctCount(const csvData_t *df, int col)
+{
+    if(df == NULL || df->hll == NULL || col < 0 || col >= df->cols)
+    {
+        return -1;
+    }
+
+    const unsigned char *registers = df->hll + ((size_t)col << CSV_HLL_BITS);
+    const double m = (double)(1 << CSV_HLL_BITS);
+    double sum = 0.0;
+    int zeros = 0;
+
+    for(int reg=0; reg<(1 << CSV_HLL_BITS); reg++)
+    {
+        sum += ldexp(1.0, -registers[reg]);
+        zeros += registers[reg] == 0;
+    }
+
+    double estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+    if(estimate <= 2.5 * m && zeros > 0) //linear counting is more accurate for small cardinalities
+    {
+        estimate = m * log(m / zeros);
+    }
+
+    return estimate;
+}
+
+/**
+ * @brief Find the bin of a value among ascending bin edges, -1 if it is outside of them.
+ */
+static int edgeBin(const float *edges, int bins, float value)
+{
+    if( ! (value >= edges[0] && value <= edges[bins]))
+    {
+        return -1; //also rejects NaN
+    }
+
+    int lo = 0, hi = bins; //edges[lo] <= value, the bin is the last edge not above the value
+    while(hi - lo > 1)
+    {
+        int mid = (lo + hi) / 2;
+        if(edges[mid] <= value)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/**
+ * @brief Count the values of a column in fixed width or explicit edge bins.
+ *
+ * With 'edges' NULL, the range [lo, hi] is split into 'bins' bins of equal width, the bin of a value
+ * being computed with one subtraction and one multiplication. Otherwise 'edges' holds 'bins' + 1
+ * ascending edges, bin i covering [edges[i], edges[i + 1]), and the bin is found by binary search.
+ * In both cases the last bin also includes its upper edge, and NaN or out of range values are not
+ * counted.
+ *
+ * Counting goes to four interleaved sub-histograms, one per row modulo four, summed at the end, so
+ * that runs of values falling into the same bin, common in sorted or low cardinality columns, do not
+ * serialise on a single counter.
+ *
+ * @param df A pointer to the data frame.
+ * @param col The column index.
+ * @param bins The number of bins.
+ * @param lo The lower edge of the first bin, ignored when 'edges' is given.
+ * @param hi The upper edge of the last bin, ignored when 'edges' is given.
+ * @param edges The 'bins' + 1 ascending bin edges, or NULL for fixed width bins.
+ * @return A dynamically allocated array of 'bins' counts, or NULL if an error occurs.
+ *
+ * @note The caller is responsible for freeing the returned array.
+ *
+ * @code
+ *   // Example usage:
+ *   long *counts = csvHistogram(dataFrame, 1, 20, -100.0f, 100.0f, NULL);
+ *   if (counts != NULL)
+ *   {
+ *       for (int bin = 0; bin < 20; bin++)
+ *       {
+ *           printf("[%6.1f, %6.1f): %ld\n", -100.0f + bin * 10.0f, -90.0f + bin * 10.0f, counts[bin]);
+ *       }
+ *       free(counts);
+ *   }
+ * @endcode
+ */
+long *csvHistogram(const csvData_t *df, int col, int bins, float lo, float hi, const float *edges)
+{
+    if(df == NULL || df->dataFrame == NULL || col < 0 || col >= df->cols || bins <= 0 ||
+       (edges == NULL && ! (hi > lo)))
+    {
+        return NULL;
+    }
+
+    long *sub = (long *)calloc((size_t)bins * 4, sizeof(long));
+    if(sub == NULL)
+    {
+        return NULL;
+    }
+
+    float **rows = df->dataFrame;
+    int row = 0, bin[4];
+
+    if(edges == NULL)
+    {
+        const double scale = (double)bins / ((double)hi - lo); //in double, 'hi - lo' may overflow a float
+
+        for(; row+4<=df->rows; row+=4) //four independent bin computations and counter updates
+        {
+            for(int lane=0; lane<4; lane++)
+            {
+                float value = rows[row + lane][col];
+                bin[lane] = -1;
+                if(value >= lo && value <= hi) //NaN and out of range values would overflow the conversion
+                {
+                    int index = (int)(((double)value - lo) * scale);
+                    bin[lane] = index >= bins ? bins - 1 : index; //the last bin is closed, rounding may also land on it
+                }
+            }
+            for(int lane=0; lane<4; lane++)
+            {
+                if(bin[lane] >= 0)
+                {
+                    sub[(size_t)lane * bins + bin[lane]]++;
+                }
+            }
+        }
+        for(; row<df->rows; row++)
+        {
+            float value = rows[row][col];
+            if(value >= lo && value <= hi)
+            {
+                int index = (int)(((double)value - lo) * scale);
+                sub[index >= bins ? bins - 1 : index]++;
+            }
+        }
+    }
+    else
+    {
+        for(int edge=0; edge<bins; edge++)
+        {
+            if( ! (edges[edge] <= edges[edge + 1]))
+            {
+                free(sub);
+                return NULL;
+            }
+        }
+
+        for(; row+4<=df->rows; row+=4)
+        {
+            for(int lane=0; lane<4; lane++)
+            {
+                bin[lane] = edgeBin(edges, bins, rows[row + lane][col]);
+            }
+            for(int lane=0; lane<4; lane++)
+            {
+                if(bin[lane] >= 0)
+                {
+                    sub[(size_t)lane * bins + bin[lane]]++;
+                }
+            }
+        }
+        for(; row<df->rows; row++)
+        {
+            int index = edgeBin(edges, bins, rows[row][col]);
+            if(index >= 0)
+            {
+                sub[index]++;
+            }
+        }
+    }
+
+    for(int lane=1; lane<4; lane++) //fold the sub-histograms into the first one
+    {
+        for(int b=0; b<bins; b++)
+        {
+            sub[b] += sub[(size_t)lane * bins + b];
+        }
+    }
+
+    long *counts = (long *)realloc(sub, sizeof(long) * bins);
+
+    return counts != NULL ? counts : sub;
+}
+
+/**
+ * @brief Create a zero-copy view of selected rows of a data frame.
+ *
+ * The returned frame shares the selected rows with 'df', in the order given by 'rows'; nothing but
+ * the row table is allocated. It can be used and sorted like any other frame, and released with
+ * 'freeDataFrame()', which leaves the shared rows alone. Changing a value through the view changes
+ * it in 'df' too. The view must be released before 'df' is, and must not be used after rows of 'df'
+ * are removed or moved: 'csvDedup()' removes them, and 'csvCompact()' copies them into a new block
+ * and releases the old rows. Sorting 'df' only reorders its row table and keeps views valid. The view
+ * has no zone map, sketches or feature names.
+ *
+ * @param df A pointer to the data frame to view.
+ * @param rows The row indices to select, in the order wanted.
+ * @param n The number of row indices.
+ * @return A pointer to a dynamically allocated view, or NULL if an error occurs.
+ *
+ * @code
+ *   // Example usage:
+ *   int *train, *test, nTrain, nTest;
+ *   if (csvTrainTestSplit(dataFrame, 3, 0.2, 42, &train, &nTrain, &test, &nTest) == TRUE)
+ *   {
+ *       csvData_t *trainView = csvView(dataFrame, train, nTrain);
+ *       // Train on trainView...
+ *       freeDataFrame(trainView);
+ *       free(train);
+ *       free(test);
+ *   }
+ * @endcode
+ */
+csvData_t *csvView(const csvData_t *df, const int *rows, int n)
+{
+    if(df == NULL || df->dataFrame == NULL || (rows == NULL && n > 0) || n < 0)
+    {
+        return NULL;
+    }
+
+    csvData_t *view = (csvData_t *)calloc(1, sizeof(csvData_t));
+    if(view == NULL)
+    {
+        return NULL;
+    }
+
+    view->parent = df;
+    view->cols = df->cols;
+    view->DFSize = (long)n * df->cols;
+    view->delim = (char *)malloc(sizeof(char) * (strlen(CSV_DELIM) + 1));
+    view->params = (char *)calloc(1, sizeof(char));
+    view->dataFrame = (float **)malloc(sizeof(float *) * (n + 1));
+
+    if(view->delim == NULL || view->params == NULL || view->dataFrame == NULL)
+    {
+        freeDataFrame(view);
+        return NULL;
+    }
+    strcpy(view->delim, CSV_DELIM);
+
+    for(int row=0; row<n; row++)
+    {
+        if(rows[row] < 0 || rows[row] >= df->rows)
+        {
+            freeDataFrame(view); //rows is still 0, nothing shared is touched
+            return NULL;
+        }
+        view->dataFrame[row] = df->dataFrame[rows[row]];
+    }
+    view->rows = n;
+
+    return view;
+}
+
+/**
+ * @brief Order the rows by stratum and shuffle every stratum, returning the strata boundaries.
+ *
+ * Fills 'order' with a row permutation in which rows sharing a label are contiguous and shuffled, and
+ * returns the number of strata, 'start' receiving the first position of each one plus a final
+ * 'df->rows'. Without a label column the whole frame is one stratum. Returns -1 on failure.
+ */
+static int shuffledStrata(const csvData_t *df, int labelCol, uint64_t seed, int **order, int **start)
+{
+    int strata = 0;
+    int *perm;
+
+    if(labelCol >= 0)
+    {
+        perm = csvArgSort(df, &labelCol, NULL, 1);
+    }
+    else
+    {
+        perm = (int *)malloc(sizeof(int) * (df->rows + 1));
+        for(int row=0; perm != NULL && row<df->rows; row++)
+        {
+            perm[row] = row;
+        }
+    }
+    int *bounds = (int *)malloc(sizeof(int) * (df->rows + 2));
+
+    if(perm == NULL || bounds == NULL)
+    {
+        free(perm);
+        free(bounds);
+        return -1;
+    }
+
+    for(int at=0; at<df->rows; at++)
+    {
+        if(at == 0 || (labelCol >= 0 && orderedKey(df->dataFrame[perm[at]][labelCol]) !=
+                                         orderedKey(df->dataFrame[perm[at - 1]][labelCol])))
+        {
+            bounds[strata++] = at;
+        }
+    }
+    bounds[strata] = df->rows;
+
+    for(int stratum=0; stratum<strata; stratum++) //Fisher-Yates within each stratum
+    {
+        for(int at=bounds[stratum + 1]-1; at>bounds[stratum]; at--)
+        {
+            int other = bounds[stratum] + (int)(nextRandom(&seed) % (uint64_t)(at - bounds[stratum] + 1));
+            int swap = perm[at];
+            perm[at] = perm[other];
+            perm[other] = swap;
+        }
+    }
+
+    *order = perm;
+    *start = bounds;
+
+    return strata;
+}
+
+/**
+ * @brief Assign every row of a data frame to one of k folds, stratified by a label column.
+ *
+ * Rows are grouped by label, shuffled within each label with the seeded generator, and dealt to the
+ * folds in turn, so every fold receives nearly the same number of rows and the same label proportions.
+ * The same seed always gives the same folds. For fold f, the rows with 'folds[row] == f' are the
+ * validation rows and the others the training rows; 'csvView()' turns either list into a frame.
+ *
+ * @param df A pointer to the data frame.
+ * @param labelCol The label column to stratify by, or -1 for plain shuffled folds.
+ * @param k The number of folds, at least 2.
+ * @param seed The seed of the shuffle.
+ * @return A dynamically allocated array holding the fold of every row, or NULL if an error occurs.
+ *
+ * @note The caller is responsible for freeing the returned array.
+ *
+ * @code
+ *   // Example usage:
+ *   int *folds = csvKFold(dataFrame, 3, 5, 42);
+ *   int *rows = (int *)malloc(sizeof(int) * dataFrame->rows);
+ *   for (int fold = 0; fold < 5; fold++)
+ *   {
+ *       int n = 0;
+ *       for (int row = 0; row < dataFrame->rows; row++)
+ *       {
+ *           if (folds[row] != fold) rows[n++] = row;
+ *       }
+ *       csvData_t *train = csvView(dataFrame, rows, n);
+ *       // Train on train, validate on the rest...
+ *       freeDataFrame(train);
+ *   }
+ *   free(rows);
+ *   free(folds);
+ * @endcode
+ */
+int *csvKFold(const csvData_t *df, int labelCol, int k, uint64_t seed)
+{
+    if(df == NULL || df->dataFrame == NULL || k < 2 || labelCol >= df->cols)
+    {
+        return NULL;
+    }
+
+    int *order, *start;
+    int *folds = (int *)malloc(sizeof(int) * (df->rows + 1));
+    int strata = folds != NULL ? shuffledStrata(df, labelCol, seed, &order, &start) : -1;
+
+    if(strata < 0)
+    {
+        free(folds);
+        return NULL;
+    }
+
+    for(int at=0; at<df->rows; at++) //dealing continues across strata, keeping the folds balanced
+    {
+        folds[order[at]] = at % k;
+    }
+
+    free(order);
+    free(start);
+
+    return folds;
+}
+
+/**
+ * @brief Split the rows of a data frame into a train and a test set, stratified by a label column.
+ *
+ * Rows are grouped by label and shuffled within each label with the seeded generator. The first
+ * rows of each shuffled label go to the test set, in proportion to 'testFraction', with rounding
+ * carried across labels so the test set size is 'testFraction' * 'df->rows' rounded. Both index
+ * lists are returned in ascending row order, ready for 'csvView()'.
+ *
+ * @param df A pointer to the data frame.
+ * @param labelCol The label column to stratify by, or -1 for a plain shuffled split.
+ * @param testFraction The fraction of rows in the test set, between 0 and 1.
+ * @param seed The seed of the shuffle.
+ * @param train Receives a dynamically allocated array of training row indices.
+ * @param nTrain Receives the number of training rows.
+ * @param test Receives a dynamically allocated array of test row indices.
+ * @param nTest Receives the number of test rows.
+ * @return TRUE on success, ERROR if the arguments are invalid, FALSE if memory could not be allocated.
+ *
+ * @note The caller is responsible for freeing both returned arrays.
+ *
+ * @code
+ *   // Example usage:
+ *   int *train, *test, nTrain, nTest;
+ *   if (csvTrainTestSplit(dataFrame, 3, 0.2, 42, &train, &nTrain, &test, &nTest) == TRUE)
+ *   {
+ *       printf("%d training rows, %d test rows\n", nTrain, nTest);
+ *       free(train);
+ *       free(test);
+ *   }
+ * @endcode
+ */
+bool_t csvTrainTestSplit(const csvData_t *df, int labelCol, double testFraction, uint64_t seed,
+                         int **train, int *nTrain, int **test, int *nTest)
+{
+    if(df == NULL || df->dataFrame == NULL || labelCol >= df->cols || ! (testFraction >= 0.0 && testFraction <= 1.0) ||
+       train == NULL || nTrain == NULL || test == NULL || nTest == NULL)
+    {
+        return ERROR;
+    }
+
+    int *order, *start;
+    unsigned char *isTest = (unsigned char *)calloc(df->rows + 1, sizeof(unsigned char));
+    int strata = isTest != NULL ? shuffledStrata(df, labelCol, seed, &order, &start) : -1;
+
+    if(strata < 0)
+    {
+        free(isTest);
+        return FALSE;
+    }
+
+    long assigned = 0;
+    for(int stratum=0; stratum<strata; stratum++)
+    {
+        long due = lround(testFraction * start[stratum + 1]) - assigned; //rounding carried over the strata
+        for(int at=start[stratum]; at<start[stratum] + due; at++)
+        {
+            isTest[order[at]] = 1;
+        }
+        assigned += due;
+    }
+    free(order);
+    free(start);
+
+    *nTest = (int)assigned;
+    *nTrain = df->rows - *nTest;
+    *train = (int *)malloc(sizeof(int) * (*nTrain + 1));
+    *test = (int *)malloc(sizeof(int) * (*nTest + 1));
+
+    if(*train == NULL || *test == NULL)
+    {
+        free(*train);
+        free(*test);
+        free(isTest);
+        return FALSE;
+    }
+
+    int trainAt = 0, testAt = 0;
+    for(int row=0; row<df->rows; row++)
+    {
+        if(isTest[row])
+        {
+            (*test)[testAt++] = row;
+        }
+        else
+        {
+            (*train)[trainAt++] = row;
+        }
+    }
+    free(isTest);
+
+    return TRUE;
+}
+
+/**
+ * @brief Map every row of a column to its output column for 'csvEncode()' and 'csvEncodeSparse()'.
+ *
+ * With 'buckets' 0, the distinct values are sorted and a row goes to the rank of its value, 'width'
+ * receiving the number of distinct values. Otherwise a row goes to the hash of its value modulo
+ * 'buckets'. NaN values map to -1. Returns NULL on failure.
+ */
+static int *encodeTargets(const csvData_t *df, int col, int buckets, int *width)
+{
+    int *target = (int *)malloc(sizeof(int) * (df->rows + 1));
+    if(target == NULL)
+    {
+        return NULL;
+    }
+
+    if(buckets > 0)
+    {
+        for(int row=0; row<df->rows; row++)
+        {
+            float value = df->dataFrame[row][col];
+            uint32_t key = orderedKey(value);
+            target[row] = isnan(value) ? -1 : (int)(hashBytes(&key, sizeof(key)) % (uint64_t)buckets);
+        }
+        *width = buckets;
+        return target;
+    }
+
+    float *distinct = (float *)malloc(sizeof(float) * (df->rows + 1));
+    if(distinct == NULL)
+    {
+        free(target);
+        return NULL;
+    }
+
+    int n = 0;
+    for(int row=0; row<df->rows; row++)
+    {
+        if( ! isnan(df->dataFrame[row][col]))
+        {
+            distinct[n++] = df->dataFrame[row][col] == 0.0f ? 0.0f : df->dataFrame[row][col];
+        }
+    }
+    qsort(distinct, n, sizeof(float), compareFloat);
+
+    int unique = 0;
+    for(int at=0; at<n; at++)
+    {
+        if(unique == 0 || distinct[at] != distinct[unique - 1])
+        {
+            distinct[unique++] = distinct[at];
+        }
+    }
+
+    for(int row=0; row<df->rows; row++)
+    {
+        float value = df->dataFrame[row][col];
+        int lo = 0, hi = unique - 1;
+
+        target[row] = -1;
+        while( ! isnan(value) && lo <= hi) //binary search of the value's rank
+        {
+            int mid = (lo + hi) / 2;
+            if(distinct[mid] < value)
+            {
+                lo = mid + 1;
+            }
+            else if(distinct[mid] > value)
+            {
+                hi = mid - 1;
+            }
+            else
+            {
+                target[row] = mid;
+                break;
+            }
+        }
+    }
+
+    free(distinct);
+    *width = unique;
+
+    return target;
+}
+
+/**
+ * @brief Expand a categorical column into one-hot or hashed indicator columns.
+ *
+ * With 'buckets' 0, the result has one column per distinct value of 'col', in ascending value order,
+ * holding 1 on the rows with that value and 0 elsewhere. With 'buckets' positive, the hashing trick is
+ * used instead: the result has 'buckets' columns and each row has a 1 in the column given by the hash
+ * of its value, so the width is fixed whatever the number of categories. NaN values give all-zero
+ * rows. Columns hashed at load time, see 'loadCsvWith()', already hold small bucket codes and are
+ * best expanded with 'buckets' 0.
+ *
+ * @param df A pointer to the data frame.
+ * @param col The categorical column index.
+ * @param buckets The number of hashed columns, or 0 for one column per distinct value.
+ * @return A pointer to a dynamically allocated 'csvData_t' holding the indicator columns, or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'. Prefer
+ *       'csvEncodeSparse()' when there are many categories.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *oneHot = csvEncode(dataFrame, 3, 0);
+ *   if (oneHot != NULL)
+ *   {
+ *       printf("%d categories\n", oneHot->cols);
+ *       freeDataFrame(oneHot);
+ *   }
+ * @endcode
+ */
+csvData_t *csvEncode(const csvData_t *df, int col, int buckets)
+{
+    if(df == NULL || df->dataFrame == NULL || col < 0 || col >= df->cols || buckets < 0)
+    {
+        return NULL;
+    }
+
+    int width;
+    int *target = encodeTargets(df, col, buckets, &width);
+    csvData_t *out = target != NULL ? allocDataFrame(df->rows, width) : NULL;
+
+    if(out != NULL)
+    {
+        memset(out->block, 0, sizeof(float) * (size_t)df->rows * width);
+        for(int row=0; row<df->rows; row++)
+        {
+            if(target[row] >= 0)
+            {
+                out->dataFrame[row][target[row]] = 1.0f;
+            }
+        }
+    }
+    free(target);
+
+    return out;
+}
+
+/**
+ * @brief Expand a categorical column into a one-hot or hashed sparse matrix in CSR layout.
+ *
+ * This function encodes like 'csvEncode()' but returns a compressed sparse row matrix: row r holds the
+ * entries 'rowStart[r]' to 'rowStart[r + 1]' - 1 of 'colIndex' and 'values', that is one entry of
+ * value 1, or none for NaN.
+ *
+ * @param df A pointer to the data frame.
+ * @param col The categorical column index.
+ * @param buckets The number of hashed columns, or 0 for one column per distinct value.
+ * @return A pointer to a dynamically allocated 'csvSparse_t', or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned matrix with 'csvFreeSparse()'.
+ *
+ * @code
+ *   // Example usage:
+ *   csvSparse_t *features = csvEncodeSparse(dataFrame, 2, 1 << 18);
+ *   if (features != NULL)
+ *   {
+ *       printf("%d x %d, %ld non-zeros\n", features->rows, features->cols, features->nnz);
+ *       csvFreeSparse(features);
+ *   }
+ * @endcode
+ */
+csvSparse_t *csvEncodeSparse(const csvData_t *df, int col, int buckets)
+{
+    if(df == NULL || df->dataFrame == NULL || col < 0 || col >= df->cols || buckets < 0)
+    {
+        return NULL;
+    }
+
+    csvSparse_t *out = (csvSparse_t *)calloc(1, sizeof(csvSparse_t));
+    if(out == NULL)
+    {
+        return NULL;
+    }
+
+    int *target = encodeTargets(df, col, buckets, &out->cols);
+    if(target == NULL)
+    {
+        free(out);
+        return NULL;
+    }
+
+    out->rows = df->rows;
+    out->rowStart = (long *)malloc(sizeof(long) * (df->rows + 1));
+    out->colIndex = (int *)malloc(sizeof(int) * (df->rows + 1));
+    out->values = (float *)malloc(sizeof(float) * (df->rows + 1));
+
+    if(out->rowStart == NULL || out->colIndex == NULL || out->values == NULL)
+    {
+        csvFreeSparse(out);
+        free(target);
+        return NULL;
+    }
+
+    for(int row=0; row<df->rows; row++)
+    {
+        out->rowStart[row] = out->nnz;
+        if(target[row] >= 0)
+        {
+            out->colIndex[out->nnz] = target[row];
+            out->values[out->nnz] = 1.0f;
+            out->nnz++;
+        }
+    }
+    out->rowStart[df->rows] = out->nnz;
+    free(target);
+
+    return out;
+}
+
+/**
+ * @brief Release a sparse matrix. Passing NULL is allowed and does nothing.
+ */
+void csvFreeSparse(csvSparse_t *sparse)
+{
+    if(sparse == NULL)
+    {
+        return;
+    }
+
+    free(sparse->rowStart);
+    free(sparse->colIndex);
+    free(sparse->values);
+    free(sparse);
+}
+
+#define MOMENT_BLOCK_ROWS (128)     //rows gathered into a column-major tile per step
+#define MOMENT_BLOCK_COLS (32)      //columns per side of a tile pair whose dot products are accumulated
+
+/**
+ * @brief Compute the covariance, or correlation, matrix of selected columns into a new frame.
+ *
+ * Columns are centred on their means, computed in a first pass. The second pass gathers
+ * MOMENT_BLOCK_ROWS rows at a time into a column-major tile of doubles, so each column of the tile is
+ * contiguous, and accumulates the dot products of every pair of columns, walking the pairs in
+ * MOMENT_BLOCK_COLS by MOMENT_BLOCK_COLS blocks that stay in cache. Only the upper triangle is
+ * computed and mirrored at the end.
+ */
+static csvData_t *momentMatrix(const csvData_t *df, const int *cols, int nCols, int correlation)
+{
+    if(df == NULL || df->dataFrame == NULL || (cols != NULL && nCols <= 0) || df->rows < 2)
+    {
+        return NULL;
+    }
+    if(cols == NULL)
+    {
+        nCols = df->cols;
+    }
+    for(int col=0; cols != NULL && col<nCols; col++)
+    {
+        if(cols[col] < 0 || cols[col] >= df->cols)
+        {
+            return NULL;
+        }
+    }
+
+    const int tileRows = MOMENT_BLOCK_ROWS;
+    double *mean = (double *)calloc(nCols + 1, sizeof(double));
+    double *sum = (double *)calloc((size_t)nCols * nCols + 1, sizeof(double));
+    double *tile = (double *)malloc(sizeof(double) * ((size_t)nCols * tileRows + 1));
+    csvData_t *out = allocDataFrame(nCols, nCols);
+
+    if(mean == NULL || sum == NULL || tile == NULL || out == NULL)
+    {
+        free(mean);
+        free(sum);
+        free(tile);
+        freeDataFrame(out);
+        return NULL;
+    }
+
+    for(int row=0; row<df->rows; row++) //means
+    {
+        const float *values = df->dataFrame[row];
+        for(int col=0; col<nCols; col++)
+        {
+            mean[col] += values[cols != NULL ? cols[col] : col];
+        }
+    }
+    for(int col=0; col<nCols; col++)
+    {
+        mean[col] /= df->rows;
+    }
+
+    for(int first=0; first<df->rows; first+=tileRows)
+    {
+        int n = df->rows - first < tileRows ? df->rows - first : tileRows;
+
+        for(int row=0; row<n; row++) //gather and centre, transposing into the tile
+        {
+            const float *values = df->dataFrame[first + row];
+            for(int col=0; col<nCols; col++)
+            {
+                tile[(size_t)col * tileRows + row] = values[cols != NULL ? cols[col] : col] - mean[col];
+            }
+        }
+
+        for(int ib=0; ib<nCols; ib+=MOMENT_BLOCK_COLS)
+        {
+            int iEnd = ib + MOMENT_BLOCK_COLS < nCols ? ib + MOMENT_BLOCK_COLS : nCols;
+            for(int jb=ib; jb<nCols; jb+=MOMENT_BLOCK_COLS)
+            {
+                int jEnd = jb + MOMENT_BLOCK_COLS < nCols ? jb + MOMENT_BLOCK_COLS : nCols;
+                for(int i=ib; i<iEnd; i++)
+                {
+                    const double *x = tile + (size_t)i * tileRows;
+                    for(int j=(jb > i ? jb : i); j<jEnd; j++)
+                    {
+                        const double *y = tile + (size_t)j * tileRows;
+                        double dot = 0.0;
+                        for(int row=0; row<n; row++) //contiguous, left for the compiler to vectorise
+                        {
+                            dot += x[row] * y[row];
+                        }
+                        sum[(size_t)i * nCols + j] += dot;
+                    }
+                }
+            }
+        }
+    }
+
+    for(int i=0; i<nCols; i++)
+    {
+        for(int j=i; j<nCols; j++)
+        {
+            double value = sum[(size_t)i * nCols + j] / (df->rows - 1);
+            if(correlation)
+            {
+                value = sum[(size_t)i * nCols + j] / sqrt(sum[(size_t)i * nCols + i] * sum[(size_t)j * nCols + j]);
+            }
+            out->dataFrame[i][j] = (float)value;
+            out->dataFrame[j][i] = (float)value;
+        }
+    }
+
+    free(mean);
+    free(sum);
+    free(tile);
+
+    return out;
+}
+
+/**
+ * @brief Compute the sample covariance matrix of selected columns of a data frame.
+ *
+ * @param df A pointer to the data frame, with at least two rows.
+ * @param cols The column indices, or NULL for every column.
+ * @param nCols The number of entries in 'cols', ignored when 'cols' is NULL.
+ * @return A pointer to a dynamically allocated nCols x nCols 'csvData_t', or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'. NaN values
+ *       propagate to every entry of their column's row and column.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *cov = csvCovariance(dataFrame, NULL, 0);
+ *   if (cov != NULL)
+ *   {
+ *       printf("variance of column 0: %f\n", cov->dataFrame[0][0]);
+ *       freeDataFrame(cov);
+ *   }
+ * @endcode
+ */
+csvData_t *csvCovariance(const csvData_t *df, const int *cols, int nCols)
+{
+    return momentMatrix(df, cols, nCols, 0);
+}
+
+/**
+ * @brief Compute the Pearson correlation matrix of selected columns of a data frame.
+ *
+ * This function centres the selected columns and computes X^T X with a cache-blocked kernel, see
+ * 'csvCovariance()', then scales every entry by the standard deviations of its two columns. Constant
+ * columns have an undefined correlation and get NaN.
+ *
+ * @param df A pointer to the data frame, with at least two rows.
+ * @param cols The column indices, or NULL for every column.
+ * @param nCols The number of entries in 'cols', ignored when 'cols' is NULL.
+ * @return A pointer to a dynamically allocated nCols x nCols 'csvData_t', or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   int features[] = {0, 1, 3};
+ *   csvData_t *corr = csvCorrelation(dataFrame, features, 3);
+ *   if (corr != NULL)
+ *   {
+ *       printf("corr(0, 3) = %f\n", corr->dataFrame[0][2]);
+ *       freeDataFrame(corr);
+ *   }
+ * @endcode
+ */
+csvData_t *csvCorrelation(const csvData_t *df, const int *cols, int nCols)
+{
+    return momentMatrix(df, cols, nCols, 1);
+}
+
+#define TRANSPOSE_TILE (32)     //side of the square tiles moved at once by the transposes
+
+/**
+ * @brief Tell whether the rows of a frame are its own block, in order.
+ *
+ * Sorting or deduplicating a frame that has a block reorders or drops entries of its row table
+ * without moving the values, after which the block no longer holds the rows one after the other.
+ */
+static int rowsInBlock(const csvData_t *df)
+{
+    if(df->block == NULL || df->parent != NULL)
+    {
+        return 0;
+    }
+
+    for(int row=0; row<df->rows; row++)
+    {
+        if(df->dataFrame[row] != df->block + (size_t)row * df->cols)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Copy the rows of a data frame into one contiguous row-major block.
+ *
+ * After this function, 'df->block' holds every value, row after row, and 'df->dataFrame[row]' points
+ * into it; the previous row arrays are released. The frame can then be handed to code expecting one
+ * dense matrix. Views of the frame made by 'csvView()' must not be used afterwards, their rows
+ * have moved. A view created by 'csvView()' gets copies of its rows and no longer depends on its
+ * parent, and a frame mapped by 'csvLoadNpy()' no longer depends on its file. Frames whose rows
+ * are already their block, in order, are left as they are; a frame with a block whose rows were
+ * reordered or dropped since, by 'csvSortBy()' or 'csvDedup()' for example, is copied into a new one.
+ *
+ * @param df A pointer to the data frame.
+ * @return TRUE on success, ERROR if 'df' is invalid, FALSE if memory could not be allocated.
+ *
+ * @code
+ *   // Example usage:
+ *   if (csvCompact(dataFrame) == TRUE)
+ *   {
+ *       fwrite(dataFrame->block, sizeof(float), (size_t)dataFrame->rows * dataFrame->cols, out);
+ *   }
+ * @endcode
+ */
+bool_t csvCompact(csvData_t *df)
+{
+    if(df == NULL || df->dataFrame == NULL)
+    {
+        return ERROR;
+    }
+    if(rowsInBlock(df))
+    {
+        return TRUE;
+    }
+
+    float *block = (float *)malloc(sizeof(float) * ((size_t)df->rows * df->cols + 1));
+    if(block == NULL)
+    {
+        return FALSE;
+    }
+
+    for(int row=0; row<df->rows; row++)
+    {
+        float *dst = block + (size_t)row * df->cols;
+        memcpy(dst, df->dataFrame[row], sizeof(float) * df->cols);
+        if(rowsOwned(df))
+        {
+            free(df->dataFrame[row]);
+        }
+        df->dataFrame[row] = dst;
+    }
+    free(df->block); //rows out of block order were copied out of it
+#ifdef CSV_HAVE_MMAP
+    if(df->mapping != NULL)
+    {
+        munmap(df->mapping, df->mappingSize);
+    }
+#endif
+    df->block = block;
+    df->parent = NULL;
+    df->mapping = NULL;
+    df->mappingSize = 0;
+
+    return TRUE;
+}
+
+/**
+ * @brief Copy a data frame into a contiguous column-major array.
+ *
+ * The result holds column 0 of every row, then column 1, and so on, which is the layout column
+ * oriented consumers expect. The copy moves TRANSPOSE_TILE x TRANSPOSE_TILE tiles at once, so both
+ * the rows read and the columns written stay in cache while a tile is moved.
+ *
+ * @param df A pointer to the data frame.
+ * @return A dynamically allocated array of 'df->cols' * 'df->rows' values, column c starting at
+ *         index c * 'df->rows', or NULL if an error occurs.
+ *
+ * @note The caller is responsible for freeing the returned array.
+ *
+ * @code
+ *   // Example usage:
+ *   float *columns = csvToColumns(dataFrame);
+ *   if (columns != NULL)
+ *   {
+ *       const float *label = columns + (size_t)3 * dataFrame->rows;
+ *       // Scan the label column...
+ *       free(columns);
+ *   }
+ * @endcode
+ */
+float *csvToColumns(const csvData_t *df)
+{
+    if(df == NULL || df->dataFrame == NULL)
+    {
+        return NULL;
+    }
+
+    size_t rows = (size_t)df->rows;
+    float *columns = (float *)malloc(sizeof(float) * (rows * df->cols + 1));
+    if(columns == NULL)
+    {
+        return NULL;
+    }
+
+    for(int rb=0; rb<df->rows; rb+=TRANSPOSE_TILE)
+    {
+        int rEnd = rb + TRANSPOSE_TILE < df->rows ? rb + TRANSPOSE_TILE : df->rows;
+        for(int cb=0; cb<df->cols; cb+=TRANSPOSE_TILE)
+        {
+            int cEnd = cb + TRANSPOSE_TILE < df->cols ? cb + TRANSPOSE_TILE : df->cols;
+            for(int row=rb; row<rEnd; row++)
+            {
+                const float *src = df->dataFrame[row];
+                for(int col=cb; col<cEnd; col++)
+                {
+                    columns[(size_t)col * rows + row] = src[col];
+                }
+            }
+        }
+    }
+
+    return columns;
+}
+
+/**
+ * @brief Build a data frame from a contiguous column-major array.
+ *
+ * This is the inverse of 'csvToColumns()': the values are transposed tile by tile into a new frame
+ * whose rows share one contiguous block.
+ *
+ * @param columns The column-major values, column c starting at index c * 'rows'.
+ * @param rows The number of rows.
+ * @param cols The number of columns.
+ * @return A pointer to a dynamically allocated 'csvData_t', or NULL if an error occurs.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   float *columns = csvToColumns(dataFrame);
+ *   // Update the columns...
+ *   csvData_t *updated = csvFromColumns(columns, dataFrame->rows, dataFrame->cols);
+ *   free(columns);
+ * @endcode
+ */
+csvData_t *csvFromColumns(const float *columns, int rows, int cols)
+{
+    if(columns == NULL || rows < 0 || cols <= 0)
+    {
+        return NULL;
+    }
+
+    csvData_t *df = allocDataFrame(rows, cols);
+    if(df == NULL)
+    {
+        return NULL;
+    }
+
+    for(int cb=0; cb<cols; cb+=TRANSPOSE_TILE)
+    {
+        int cEnd = cb + TRANSPOSE_TILE < cols ? cb + TRANSPOSE_TILE : cols;
+        for(int rb=0; rb<rows; rb+=TRANSPOSE_TILE)
+        {
+            int rEnd = rb + TRANSPOSE_TILE < rows ? rb + TRANSPOSE_TILE : rows;
+            for(int col=cb; col<cEnd; col++)
+            {
+                const float *src = columns + (size_t)col * rows;
+                for(int row=rb; row<rEnd; row++)
+                {
+                    df->block[(size_t)row * cols + col] = src[row];
+                }
+            }
+        }
+    }
+
+    return df;
+}
+
+/**
+ * @brief Transpose a square row-major matrix in place.
+ *
+ * Tiles on the diagonal are transposed within themselves and every tile above the diagonal is
+ * swapped, transposed, with its mirror below it, two TRANSPOSE_TILE x TRANSPOSE_TILE tiles at a time.
+ * Rectangular frames can be handled block by block over square sub-matrices of a compacted frame,
+ * see 'csvCompact()', or out of place with 'csvToColumns()'.
+ *
+ * @param matrix The n x n values, row after row.
+ * @param n The number of rows and columns.
+ * @return TRUE on success, ERROR if the arguments are invalid.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *corr = csvCorrelation(dataFrame, NULL, 0); // square, contiguous
+ *   csvTransposeInPlace(corr->block, corr->rows);
+ *   freeDataFrame(corr);
+ * @endcode
+ */
+bool_t csvTransposeInPlace(float *matrix, int n)
+{
+    if(matrix == NULL || n < 0)
+    {
+        return ERROR;
+    }
+
+    for(int ib=0; ib<n; ib+=TRANSPOSE_TILE)
+    {
+        int iEnd = ib + TRANSPOSE_TILE < n ? ib + TRANSPOSE_TILE : n;
+        for(int jb=ib; jb<n; jb+=TRANSPOSE_TILE)
+        {
+            int jEnd = jb + TRANSPOSE_TILE < n ? jb + TRANSPOSE_TILE : n;
+            for(int i=ib; i<iEnd; i++)
+            {
+                for(int j=(jb == ib ? i + 1 : jb); j<jEnd; j++)
+                {
+                    float swap = matrix[(size_t)i * n + j];
+                    matrix[(size_t)i * n + j] = matrix[(size_t)j * n + i];
+                    matrix[(size_t)j * n + i] = swap;
+                }
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+#define NPY_MAGIC       ("\x93NUMPY")
+#define NPY_STAGE_ROWS  (1 << 16)   //rows staged per write when a frame has no contiguous block
+
+/**
+ * @brief Save a data frame as a NumPy '.npy' file.
+ *
+ * The file holds a 2-D float32 array of shape (rows, cols) in C order, readable with 'numpy.load()'
+ * or 'numpy.load(path, mmap_mode="r")'. The header is padded so that the data starts on a 64 byte
+ * boundary. A frame with a contiguous block, see 'csvCompact()', is written with a single 'fwrite()';
+ * other frames are staged NPY_STAGE_ROWS rows at a time.
+ *
+ * @param df A pointer to the data frame to save.
+ * @param path The path of the file to create or overwrite.
+ * @return TRUE on success, ERROR if the arguments are invalid, FALSE if the file could not be written.
+ *
+ * @code
+ *   // Example usage:
+ *   if (csvSaveNpy(dataFrame, "training_data.npy") != TRUE)
+ *   {
+ *       puts("Error occurred while saving the data frame.");
+ *   }
+ * @endcode
+ */
+bool_t csvSaveNpy(const csvData_t *df, const char *path)
+{
+    if(df == NULL || df->dataFrame == NULL || path == NULL)
+    {
+        return ERROR;
+    }
+
+    const uint16_t probe = 1;
+    unsigned char header[256];
+    char dict[192];
+    int dictLen = snprintf(dict, sizeof(dict), "{'descr': '%cf4', 'fortran_order': False, 'shape': (%d, %d), }",
+                           *(const unsigned char *)&probe ? '<' : '>', df->rows, df->cols);
+    size_t total = 10 + dictLen + 1;
+    total = (total + 63) / 64 * 64; //pad the header, the newline included, to 64 bytes
+
+    memcpy(header, NPY_MAGIC, 6);
+    header[6] = 1; //format version 1.0
+    header[7] = 0;
+    header[8] = (unsigned char)((total - 10) & 0xFF);
+    header[9] = (unsigned char)((total - 10) >> 8);
+    memcpy(header + 10, dict, dictLen);
+    memset(header + 10 + dictLen, ' ', total - 10 - dictLen);
+    header[total - 1] = '\n';
+
+    FILE *filePtr = fopen(path, "wb");
+    if(filePtr == NULL)
+    {
+        puts("Could not open the file.");
+        return FALSE;
+    }
+
+    bool_t ok = fwrite(header, 1, total, filePtr) == total ? TRUE : FALSE;
+    size_t cols = (size_t)df->cols;
+
+    if(ok == TRUE && df->rows > 0 && rowsInBlock(df)) //rows still in block order, one write
+    {
+        ok = fwrite(df->block, sizeof(float) * cols, df->rows, filePtr) == (size_t)df->rows ? TRUE : FALSE;
+        fclose(filePtr);
+        return ok;
+    }
+
+    int stageRows = df->rows < NPY_STAGE_ROWS ? df->rows : NPY_STAGE_ROWS;
+    float *stage = (float *)malloc(sizeof(float) * (stageRows * cols + 1));
+    if(stage == NULL)
+    {
+        ok = FALSE;
+    }
+
+    for(int first=0; first<df->rows && ok == TRUE; first+=stageRows)
+    {
+        int n = df->rows - first < stageRows ? df->rows - first : stageRows;
+        for(int row=0; row<n; row++)
+        {
+            memcpy(stage + row * cols, df->dataFrame[first + row], sizeof(float) * cols);
+        }
+        ok = fwrite(stage, sizeof(float) * cols, n, filePtr) == (size_t)n ? TRUE : FALSE;
+    }
+
+    free(stage);
+    if(fclose(filePtr) != 0)
+    {
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief Read the value of a key of a '.npy' header dictionary, or NULL if it is missing.
+ */
+static const char *npyField(const char *dict, const char *key)
+{
+    const char *at = strstr(dict, key);
+    if(at == NULL)
+    {
+        return NULL;
+    }
+
+    at += strlen(key);
+    while(*at == ' ' || *at == '\'' || *at == ':')
+    {
+        at++;
+    }
+
+    return at;
+}
+
+/**
+ * @brief Load a NumPy '.npy' file into a data frame, mapping it when possible.
+ *
+ * Two dimensional arrays of shape (rows, cols) and one dimensional arrays, taken as one column, are
+ * supported. A little endian float32 array in C order is mapped into memory on POSIX systems and the
+ * rows of the frame point straight into the mapping: nothing is parsed or copied, pages are read as
+ * they are touched. Changes made through the frame stay private and are not written to the file.
+ * float64 and Fortran ordered arrays, and every array on other systems, are read and converted into
+ * a contiguous block instead.
+ *
+ * @param path The path of the '.npy' file.
+ * @return A pointer to a dynamically allocated 'csvData_t', or NULL if the file is missing or not a
+ *         supported '.npy' file.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()', which also
+ *       unmaps the file.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *dataFrame = csvLoadNpy("training_data.npy");
+ *   if (dataFrame != NULL)
+ *   {
+ *       printf("%d x %d\n", dataFrame->rows, dataFrame->cols);
+ *       freeDataFrame(dataFrame);
+ *   }
+ * @endcode
+ */
+csvData_t *csvLoadNpy(const char *path)
+{
+    if(path == NULL)
+    {
+        return NULL;
+    }
+
+    FILE *filePtr = fopen(path, "rb");
+    if(filePtr == NULL)
+    {
+        puts("Could not open the file.");
+        return NULL;
+    }
+
+    //PARSE HEADER ------------------------------------------------------------
+
+    unsigned char preamble[12];
+    char dict[4096];
+    size_t headerLen = 0, offset = 0;
+
+    if(fread(preamble, 1, 10, filePtr) == 10 && memcmp(preamble, NPY_MAGIC, 6) == 0)
+    {
+        if(preamble[6] == 1)
+        {
+            headerLen = preamble[8] | (size_t)preamble[9] << 8;
+            offset = 10;
+        }
+        else if(fread(preamble + 10, 1, 2, filePtr) == 2) //versions 2 and 3 have a 4 byte length
+        {
+            headerLen = preamble[8] | (size_t)preamble[9] << 8 | (size_t)preamble[10] << 16 | (size_t)preamble[11] << 24;
+            offset = 12;
+        }
+    }
+    if(headerLen == 0 || headerLen >= sizeof(dict) || fread(dict, 1, headerLen, filePtr) != headerLen)
+    {
+        puts("Not a supported '.npy' file.");
+        fclose(filePtr);
+        return NULL;
+    }
+    dict[headerLen] = '\0';
+    offset += headerLen;
+
+    const uint16_t probe = 1;
+    const char native = *(const unsigned char *)&probe ? '<' : '>';
+    const char *descr = npyField(dict, "'descr'");
+    const char *fortran = npyField(dict, "'fortran_order'");
+    const char *shape = npyField(dict, "'shape'");
+    long dims[2] = {0, 1};
+    int nDims = 0, itemSize = 0, isFortran = fortran != NULL && strncmp(fortran, "True", 4) == 0;
+
+    if(descr != NULL && (descr[0] == native || descr[0] == '=') && descr[1] == 'f')
+    {
+        itemSize = descr[2] == '4' ? 4 : descr[2] == '8' ? 8 : 0;
+    }
+    if(shape != NULL && *shape == '(')
+    {
+        shape++;
+        while(nDims < 3)
+        {
+            char *end;
+            long dim = strtol(shape, &end, 10);
+            if(end == shape)
+            {
+                break;
+            }
+            if(nDims < 2)
+            {
+                dims[nDims] = dim;
+            }
+            nDims++;
+            shape = end;
+            while(*shape == ',' || *shape == ' ')
+            {
+                shape++;
+            }
+        }
+    }
+    if(itemSize == 0 || nDims < 1 || nDims > 2 || dims[0] < 0 || dims[1] < 0 || dims[0] > 0x7FFFFFFF || dims[1] > 0x7FFFFFFF)
+    {
+        puts("Not a supported '.npy' file.");
+        fclose(filePtr);
+        return NULL;
+    }
+
+    int rows = (int)dims[0], cols = (int)dims[1];
+    size_t count = (size_t)rows * cols;
+    csvData_t *df = NULL;
+
+    //MAP, ZERO COPY ----------------------------------------------------------
+
+#ifdef CSV_HAVE_MMAP
+    if(itemSize == 4 && (! isFortran || cols == 1) && count > 0)
+    {
+        size_t size = offset + count * sizeof(float);
+        struct stat st;
+        void *mapping = MAP_FAILED;
+
+        if(fstat(fileno(filePtr), &st) == 0 && (size_t)st.st_size >= size)
+        {
+            mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(filePtr), 0);
+        }
+
+        df = mapping != MAP_FAILED ? (csvData_t *)calloc(1, sizeof(csvData_t)) : NULL;
+        if(df != NULL)
+        {
+            float *data = (float *)((char *)mapping + offset); //the header keeps the data 64 byte aligned
+            df->mapping = mapping;
+            df->mappingSize = size;
+            df->cols = cols;
+            df->DFSize = (long)count;
+            df->delim = (char *)malloc(sizeof(char) * (strlen(CSV_DELIM) + 1));
+            df->params = (char *)calloc(1, sizeof(char));
+            df->dataFrame = (float **)malloc(sizeof(float *) * (rows + 1));
+
+            if(df->delim == NULL || df->params == NULL || df->dataFrame == NULL)
+            {
+                freeDataFrame(df);
+                fclose(filePtr);
+                return NULL;
+            }
+            strcpy(df->delim, CSV_DELIM);
+            for(int row=0; row<rows; row++)
+            {
+                df->dataFrame[row] = data + (size_t)row * cols;
+            }
+            df->rows = rows;
+
+            fclose(filePtr); //the mapping outlives the stream
+            return df;
+        }
+        else if(mapping != MAP_FAILED)
+        {
+            munmap(mapping, size);
+        }
+    }
+#endif
+
+    //READ AND CONVERT --------------------------------------------------------
+
+    unsigned char *raw = (unsigned char *)malloc(count * itemSize + 1);
+    df = raw != NULL ? allocDataFrame(rows, cols) : NULL;
+
+    if(df == NULL || fread(raw, itemSize, count, filePtr) != count)
+    {
+        puts("Could not read the '.npy' file.");
+        free(raw);
+        freeDataFrame(df);
+        fclose(filePtr);
+        return NULL;
+    }
+    fclose(filePtr);
+
+    for(size_t at=0; at<count; at++)
+    {
+        size_t dst = isFortran ? (at % rows) * cols + at / rows : at; //Fortran order stores column after column
+        if(itemSize == 4)
+        {
+            memcpy(&df->block[dst], raw + at * 4, 4);
+        }
+        else
+        {
+            double value;
+            memcpy(&value, raw + at * 8, 8);
+            df->block[dst] = (float)value;
+        }
+    }
+    free(raw);
+
+    return df;
+}
+
+/*
+ * Structural index of a '.csv' file held in memory: where every line starts, and where every field
+ * starts relative to its line, stored column after column so that the conversion of one column
+ * reads its offsets in order. Fields follow the tokenising of 'loadCsvWith()': runs of deliminator
+ * characters separate them and the line break stays part of the last field of a line.
+ */
+typedef struct {
+    const char *data;           //file contents, not NUL terminated
+    size_t size;
+    int rows;                   //data lines, the first line holds the feature names
+    int cols;                   //fields of the first data line
+    size_t *rowStart;           //rows + 1 offsets, the last one is 'size'
+    uint32_t *offsets;          //cols * rows field offsets from the start of their line, UINT32_MAX when missing
+    long long fields;           //fields present
+    unsigned char isDelim[256];
+}csvIndex_t;
+
+#define INDEX_MISSING (UINT32_MAX)
+
+static void indexFree(csvIndex_t *idx)
+{
+    free(idx->rowStart);
+    free(idx->offsets);
+    idx->rowStart = NULL;
+    idx->offsets = NULL;
+}
+
+/**
+ * @brief Offset just past the line starting at 'at': after its line break, or the end of the data.
+ */
+static size_t lineAfter(const char *data, size_t size, size_t at)
+{
+    if(at >= size)
+    {
+        return size;
+    }
+
+    const char *next = (const char *)memchr(data + at, '\n', size - at);
+    return next != NULL ? (size_t)(next - data) + 1 : size;
+}
+
+/**
+ * @brief Index the whole data lines in ['from', 'to') of 'data', the file contents. Lines are found
+ *        with 'memchr()', which the C library vectorises, and the fields of a line with one pass
+ *        over its bytes. As in 'loadCsvWith()', the first data line of the file, the one after the
+ *        header, sets the number of columns whichever lines are indexed.
+ */
+static bool_t indexBuild(csvIndex_t *idx, const char *data, size_t size, size_t from, size_t to, const char *delim)
+{
+    memset(idx, 0, sizeof(csvIndex_t));
+    idx->data = data;
+    idx->size = size;
+    for(const char *at = delim; *at; at++)
+    {
+        idx->isDelim[(unsigned char)*at] = 1;
+    }
+
+    size_t lines = 0;
+    if(to > from)
+    {
+        lines = data[to - 1] != '\n' ? 1 : 0; //a last line without a line break
+        for(const char *at = data + from; at < data + to && (at = memchr(at, '\n', data + to - at)) != NULL; at++)
+        {
+            lines++;
+        }
+    }
+    if(lines > 0x7FFFFFFE)
+    {
+        puts("Too many lines to index.");
+        return FALSE;
+    }
+    idx->rows = (int)lines;
+
+    idx->rowStart = (size_t *)malloc(sizeof(size_t) * (idx->rows + 2));
+    if(idx->rowStart == NULL)
+    {
+        return FALSE;
+    }
+
+    size_t line = from;
+    for(int row=0; row<idx->rows; row++) //line starts
+    {
+        size_t next = lineAfter(data, to, line);
+        if(next - line >= INDEX_MISSING)
+        {
+            puts("Line too long to index.");
+            indexFree(idx);
+            return FALSE;
+        }
+        idx->rowStart[row] = line;
+        line = next;
+    }
+    idx->rowStart[idx->rows] = to;
+
+    size_t first = lineAfter(data, size, 0); //the first data line sets the number of columns
+    const char *at = first < size ? data + first : NULL, *stop = first < size ? data + lineAfter(data, size, first) : NULL;
+    while(at < stop)
+    {
+        while(at < stop && idx->isDelim[(unsigned char)*at])
+        {
+            at++;
+        }
+        if(at == stop)
+        {
+            break;
+        }
+        idx->cols++;
+        while(at < stop && ! idx->isDelim[(unsigned char)*at])
+        {
+            at++;
+        }
+    }
+
+    idx->offsets = (uint32_t *)malloc(sizeof(uint32_t) * ((size_t)idx->rows * idx->cols + 1));
+    if(idx->offsets == NULL)
+    {
+        indexFree(idx);
+        return FALSE;
+    }
+
+    for(int row=0; row<idx->rows; row++)
+    {
+        const char *start = data + idx->rowStart[row], *at = start, *stop = data + idx->rowStart[row + 1];
+        int col = 0;
+
+        while(col < idx->cols)
+        {
+            while(at < stop && idx->isDelim[(unsigned char)*at])
+            {
+                at++;
+            }
+            if(at == stop)
+            {
+                break;
+            }
+            idx->offsets[(size_t)col * idx->rows + row] = (uint32_t)(at - start);
+            col++;
+            while(at < stop && ! idx->isDelim[(unsigned char)*at])
+            {
+                at++;
+            }
+        }
+        idx->fields += col;
+        for(; col<idx->cols; col++) //short line
+        {
+            idx->offsets[(size_t)col * idx->rows + row] = INDEX_MISSING;
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Convert one column of an indexed file into 'out', one converter call per row.
+ *
+ * Every field is copied into a NUL terminated scratch buffer first: the converters fall back to the C
+ * library, which would otherwise read past a field made of white space into the next line.
+ */
+static bool_t indexConvertColumn(const csvIndex_t *idx, int col, converter_t convert, convertCtx_t *ctx, float *out)
+{
+    char small[64];
+    char *scratch = small;
+    size_t capacity = sizeof(small);
+    const uint32_t *offsets = idx->offsets + (size_t)col * idx->rows;
+
+    for(int row=0; row<idx->rows; row++)
+    {
+        if(offsets[row] == INDEX_MISSING)
+        {
+            out[row] = NAN;
+            continue;
+        }
+
+        const char *field = idx->data + idx->rowStart[row] + offsets[row];
+        const char *stop = idx->data + idx->rowStart[row + 1];
+        size_t len = 0;
+        while(field + len < stop && ! idx->isDelim[(unsigned char)field[len]])
+        {
+            len++;
+        }
+
+        if(len >= capacity) //a long field, grow the scratch buffer
+        {
+            char *grown = (char *)malloc(len + 1);
+            if(grown == NULL)
+            {
+                if(scratch != small)
+                {
+                    free(scratch);
+                }
+                return FALSE;
+            }
+            if(scratch != small)
+            {
+                free(scratch);
+            }
+            scratch = grown;
+            capacity = len + 1;
+        }
+        memcpy(scratch, field, len);
+        scratch[len] = '\0';
+        out[row] = convert(scratch, ctx);
+    }
+
+    if(scratch != small)
+    {
+        free(scratch);
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief Map a whole file into memory, or read it where mapping is not available.
+ *
+ * Sets '*mapping' when the contents are mapped, they are otherwise in a buffer freed with 'free()'.
+ * An empty file gives a NULL buffer and a size of 0. Returns FALSE if the file could not be read.
+ */
+static bool_t readWhole(const char *path, char **data, size_t *size, void **mapping)
+{
+    FILE *filePtr = fopen(path, "rb");
+
+    *data = NULL;
+    *size = 0;
+    *mapping = NULL;
+    if(filePtr == NULL)
+    {
+        puts("Could not open the file.");
+        return FALSE;
+    }
+
+    long length = fseek(filePtr, 0, SEEK_END) == 0 ? ftell(filePtr) : -1;
+    if(length > 0)
+    {
+        *size = (size_t)length;
+#ifdef CSV_HAVE_MMAP
+        void *mapped = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fileno(filePtr), 0);
+        if(mapped != MAP_FAILED)
+        {
+            *mapping = mapped;
+            *data = (char *)mapped;
+        }
+#endif
+        if(*data == NULL)
+        {
+            *data = (char *)malloc(*size);
+            if(*data == NULL || fseek(filePtr, 0, SEEK_SET) != 0 || fread(*data, 1, *size, filePtr) != *size)
+            {
+                puts("Could not read the file.");
+                free(*data);
+                *data = NULL;
+                fclose(filePtr);
+                return FALSE;
+            }
+        }
+    }
+    fclose(filePtr); //a mapping outlives the stream
+
+    return length >= 0 ? TRUE : FALSE;
+}
+
+static void releaseWhole(char *data, size_t size, void *mapping)
+{
+#ifdef CSV_HAVE_MMAP
+    if(mapping != NULL)
+    {
+        munmap(mapping, size);
+        return;
+    }
+#else
+    (void)mapping;
+#endif
+    (void)size;
+    free(data);
+}
+
+/**
+ * @brief Pick the converter of every indexed column from the load options, see 'loadCsvWith()'.
+ */
+static converter_t *indexConverters(int cols, const csvLoadOpts_t *opts)
+{
+    converter_t *convert = (converter_t *)malloc(sizeof(converter_t) * (cols + 1));
+
+    for(int col=0; convert != NULL && col<cols; col++)
+    {
+        csvType_t type = opts->colTypes != NULL ? opts->colTypes[col] : CSV_FLOAT;
+        for(int hashCol=0; hashCol<opts->nHashCols; hashCol++)
+        {
+            type = opts->hashCols[hashCol] == col ? CSV_HASHED : type;
+        }
+        convert[col] = converterFor(type);
+    }
+
+    return convert;
+}
+
+/**
+ * @brief The feature names of the header line, concatenated as 'loadCsvWith()' does, or NULL if
+ *        memory could not be allocated.
+ */
+static char *indexParams(const char *data, size_t size)
+{
+    char buffer[1024];
+    char *save;
+    char *params = (char *)malloc(sizeof(char) * 1024);
+
+    if(params == NULL)
+    {
+        return NULL;
+    }
+    params[0] = '\0';
+
+    const char *headerEnd = size > 0 ? (const char *)memchr(data, '\n', size) : NULL;
+    size_t headerLen = headerEnd != NULL ? (size_t)(headerEnd - data) + 1 : size;
+
+    headerLen = headerLen < sizeof(buffer) - 1 ? headerLen : sizeof(buffer) - 1; //as much as 'fgets()' reads
+    if(headerLen > 0)
+    {
+        memcpy(buffer, data, headerLen);
+    }
+    buffer[headerLen] = '\0';
+    for(char *tokens = splitToken(buffer, CSV_DELIM, &save); tokens; tokens = splitToken(NULL, CSV_DELIM, &save))
+    {
+        char *label = trimToken(tokens);
+        if(label == NULL)
+        {
+            free(params);
+            return NULL;
+        }
+        strcat(params, label);
+        free(label);
+    }
+
+    return params;
+}
+
+#ifdef CSV_HAVE_THREADS
+typedef struct {
+    const csvIndex_t *idx;
+    const converter_t *convert;
+    convertCtx_t ctx;       //own fallback count, summed by the caller
+    float *columns;
+    int first, step;        //this worker converts columns first, first + step, ...
+    bool_t ok;
+}columnWork_t;
+
+static void *convertColumns(void *arg)
+{
+    columnWork_t *work = (columnWork_t *)arg;
+
+    for(int col=work->first; work->ok == TRUE && col<work->idx->cols; col+=work->step)
+    {
+        work->ok = indexConvertColumn(work->idx, col, work->convert[col], &work->ctx,
+                                      work->columns + (size_t)col * work->idx->rows);
+    }
+
+    return NULL;
+}
+#endif
+
+/**
+ * @brief Second phase of 'csvLoadIndexed()': convert every column of the index, then transpose.
+ */
+static csvData_t *indexedFrame(const csvIndex_t *idx, const csvLoadOpts_t *opts, convertCtx_t *ctx,
+                               csvStats_t *stats, statsTimer_t *timer)
+{
+    csvTracer_t *tracer = opts->tracer;
+    float *columns = (float *)malloc(sizeof(float) * ((size_t)idx->rows * idx->cols + 1));
+    converter_t *convert = indexConverters(idx->cols, opts);
+    size_t columnBytes = sizeof(float) * ((size_t)idx->rows * idx->cols + 1);
+
+    if(columns == NULL || convert == NULL)
+    {
+        puts("Could not allocate the columns.");
+        free(columns);
+        free(convert);
+        return NULL;
+    }
+    STATS_HOLD(stats, columnBytes);
+    STATS_STAGE(stats, *timer, CSV_STAGE_ALLOC);
+
+#ifdef CSV_HAVE_THREADS
+    int workers = workerCount((long long)idx->rows * idx->cols);
+    workers = workers < idx->cols ? workers : idx->cols;
+    if(workers > 1) //every worker owns every workers-th column, the index is only read
+    {
+        columnWork_t work[CSV_MAX_THREADS];
+        bool_t ok = TRUE;
+        double span = traceBegin(tracer);
+
+        for(int worker=0; worker<workers; worker++)
+        {
+            work[worker].idx = idx;
+            work[worker].convert = convert;
+            work[worker].ctx.buckets = ctx->buckets;
+            work[worker].ctx.fallbacks = 0;
+            work[worker].columns = columns;
+            work[worker].first = worker;
+            work[worker].step = workers;
+            work[worker].ok = TRUE;
+        }
+        runWorkers(convertColumns, work, sizeof(columnWork_t), workers);
+        for(int worker=0; worker<workers; worker++)
+        {
+            ctx->fallbacks += work[worker].ctx.fallbacks;
+            ok = work[worker].ok == TRUE ? ok : FALSE;
+        }
+        if(ok != TRUE)
+        {
+            puts("Could not convert the file.");
+            STATS_HOLD(stats, -(long long)columnBytes);
+            free(columns);
+            free(convert);
+            return NULL;
+        }
+        traceEnd(tracer, "convert columns", span, idx->rows, -1); //workers do not write the caller's tracer
+    }
+#else
+    int workers = 1;
+#endif
+
+    for(int col=0; workers == 1 && col<idx->cols; col++) //one converter per loop, one contiguous column per converter
+    {
+        double span = traceBegin(tracer);
+        if(indexConvertColumn(idx, col, convert[col], ctx, columns + (size_t)col * idx->rows) != TRUE)
+        {
+            puts("Could not convert the file.");
+            STATS_HOLD(stats, -(long long)columnBytes);
+            free(columns);
+            free(convert);
+            return NULL;
+        }
+        traceEnd(tracer, "convert column", span, idx->rows, -1);
+    }
+    STATS_STAGE(stats, *timer, CSV_STAGE_CONVERT);
+
+    double span = traceBegin(tracer);
+    csvData_t *df = idx->cols > 0 ? csvFromColumns(columns, idx->rows, idx->cols) : allocDataFrame(idx->rows, 0);
+    STATS_HOLD(stats, -(long long)columnBytes);
+    free(columns);
+    free(convert);
+    char *params = df != NULL ? indexParams(idx->data, idx->size) : NULL;
+    if(params == NULL)
+    {
+        puts("Could not allocate the frame.");
+        freeDataFrame(df);
+        return NULL;
+    }
+    free(df->params);
+    df->params = params;
+    csvBuildZoneMap(df, CSV_ZONE_ROWS);
+    STATS_HOLD(stats, sizeof(csvData_t) + 1024 + sizeof(float *) * (idx->rows + 1) + columnBytes);
+    STATS_STAGE(stats, *timer, CSV_STAGE_ALLOC);
+    traceEnd(tracer, "transpose", span, idx->rows, -1);
+
+    return df;
+}
+
+/**
+ * @brief Load a '.csv' file in two phases: index the fields of every line, then convert column by column.
+ *
+ * The whole file is mapped into memory (read, where mapping is not available) and a structural index
+ * of line starts and field offsets is built in one pass. Each column is then converted on its own,
+ * with the single converter its type selects running over all the rows of the column into a
+ * contiguous column buffer, and the columns are finally transposed into a row-major frame with
+ * 'csvFromColumns()'. Compared with 'loadCsvWith()', the file is read once instead of twice and the
+ * inner conversion loop never changes converter.
+ *
+ * Columns are converted on the calling thread. When the library is compiled with CSV_ENABLE_THREADS
+ * on a POSIX system, files of several times CSV_PARALLEL_WORK fields are converted by up to
+ * CSV_MAX_THREADS pthreads instead, each owning every n-th column: the index is shared read-only
+ * and every column buffer has a single writer, so no locking is needed and the frame is the same.
+ *
+ * Only 'opts->path', 'colTypes', 'hashCols', 'hashBuckets', 'stats' and 'tracer' apply, with the
+ * meaning they have for 'loadCsvWith()'; other options are rejected. The values are identical to
+ * those of 'loadCsvWith()' for lines shorter than its 1024 byte buffer; longer lines are not split.
+ * Stage times in 'opts->stats' are measured whole rather than sampled, the transpose counting as
+ * allocation, and the tracer records one span per converted column, or one span for the whole
+ * conversion when it is split over threads.
+ *
+ * @param opts A pointer to the load options, or NULL to load CSV_PATH.
+ * @return A pointer to a dynamically allocated 'csvData_t' structure, or NULL if an option is not
+ *         supported, the file could not be read or memory could not be allocated.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   csvType_t types[] = {CSV_FLOAT, CSV_FLOAT, CSV_HASHED, CSV_INT};
+ *   csvLoadOpts_t opts = {0};
+ *   opts.colTypes = types;
+ *   opts.hashBuckets = 1024;
+ *   csvData_t *dataFrame = csvLoadIndexed(&opts);
+ *   if (dataFrame != NULL)
+ *   {
+ *       // Same frame as loadCsvWith(NULL, &opts)...
+ *       freeDataFrame(dataFrame);
+ *   }
+ * @endcode
+ */
+csvData_t *csvLoadIndexed(const csvLoadOpts_t *opts)
+{
+    csvLoadOpts_t none = {0};
+    statsTimer_t timer = {0}, total = {0};
+    csvIndex_t idx;
+    char *data;
+    size_t size;
+    void *mapping;
+
+    if(opts == NULL)
+    {
+        opts = &none;
+    }
+
+    if(opts->nLookups > 0 || opts->dedupCapacity > 0 || opts->sketchK > 0 || opts->distinctCounts == TRUE ||
+       opts->sampleMode != CSV_SAMPLE_NONE)
+    {
+        puts("Option not supported by csvLoadIndexed().");
+        return NULL;
+    }
+    for(int col=0; col<opts->nHashCols; col++)
+    {
+        if(opts->hashCols == NULL || opts->hashCols[col] < 0 || opts->hashBuckets <= 0)
+        {
+            puts("Invalid hashed columns.");
+            return NULL;
+        }
+    }
+
+    if(opts->stats != NULL)
+    {
+        memset(opts->stats, 0, sizeof(csvStats_t));
+    }
+#ifdef CSV_ENABLE_STATS
+    csvStats_t *stats = opts->stats;
+#else
+    csvStats_t *stats = NULL;
+#endif
+    STATS_CALIBRATE(stats, timer);
+    STATS_COUNTERS(stats, total);
+    STATS_START(stats, total, 1, 1.0);
+    STATS_START(stats, timer, 1, 1.0);
+    csvTracer_t *tracer = opts->tracer;
+    double loadSpan = traceBegin(tracer), span = loadSpan;
+
+    //PHASE 1, READ AND INDEX -------------------------------------------------
+
+    if(readWhole(opts->path != NULL ? opts->path : CSV_PATH, &data, &size, &mapping) != TRUE)
+    {
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+    STATS_HOLD(stats, mapping == NULL ? size : 0);
+    STATS_STAGE(stats, timer, CSV_STAGE_IO);
+    traceEnd(tracer, "read", span, -1, (long long)size);
+
+    span = traceBegin(tracer);
+    if(indexBuild(&idx, data, size, lineAfter(data, size, 0), size, CSV_DELIM) != TRUE)
+    {
+        puts("Could not index the file.");
+        releaseWhole(data, size, mapping);
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+    if(hashTypesValid(opts, idx.cols) != TRUE)
+    {
+        puts("Invalid hashed columns.");
+        indexFree(&idx);
+        releaseWhole(data, size, mapping);
+        STATS_TOTAL(stats, total);
+        return NULL;
+    }
+    size_t indexBytes = sizeof(size_t) * (idx.rows + 2) + sizeof(uint32_t) * ((size_t)idx.rows * idx.cols + 1);
+    STATS_HOLD(stats, indexBytes);
+    STATS_STAGE(stats, timer, CSV_STAGE_SCAN);
+    traceEnd(tracer, "index", span, idx.rows, (long long)size);
+
+    //PHASE 2, CONVERT COLUMN BY COLUMN ---------------------------------------
+
+    convertCtx_t ctx = {(uint64_t)opts->hashBuckets, 0}; //only read by CSV_HASHED columns, which need buckets
+    csvData_t *df = indexedFrame(&idx, opts, &ctx, stats, &timer);
+
+    STATS_COUNT(stats, bytes, (long long)size);
+    STATS_COUNT(stats, records, idx.rows);
+    STATS_COUNT(stats, fields, idx.fields);
+    STATS_COUNT(stats, fallbacks, ctx.fallbacks);
+    STATS_HOLD(stats, -(long long)(indexBytes + (mapping == NULL ? size : 0)));
+    indexFree(&idx);
+    releaseWhole(data, size, mapping);
+    STATS_TOTAL(stats, total);
+    traceEnd(tracer, "load", loadSpan, df != NULL ? df->rows : -1, (long long)size);
+
+    return df;
+}
+
+/*
+ * Column cache of lazy frames. A column is converted into a private buffer and then published with a
+ * compare-exchange on its slot; a thread that loses the race frees its buffer and uses the winner's.
+ */
+#ifdef CSV_HAVE_ATOMICS
+typedef _Atomic(float *) columnSlot_t;
+
+static float *slotLoad(columnSlot_t *slot)
+{
+    return atomic_load_explicit(slot, memory_order_acquire);
+}
+
+static int slotPublish(columnSlot_t *slot, float **column)
+{
+    float *expected = NULL;
+    if(atomic_compare_exchange_strong_explicit(slot, &expected, *column, memory_order_acq_rel, memory_order_acquire))
+    {
+        return 1;
+    }
+    *column = expected;
+    return 0;
+}
+#elif defined(__GNUC__)
+typedef float *columnSlot_t;
+
+static float *slotLoad(columnSlot_t *slot)
+{
+    return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+static int slotPublish(columnSlot_t *slot, float **column)
+{
+    float *expected = NULL;
+    if(__atomic_compare_exchange_n(slot, &expected, *column, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        return 1;
+    }
+    *column = expected;
+    return 0;
+}
+#else
+typedef float *columnSlot_t; //no atomics, a lazy frame must then be used by one thread at a time
+
+static float *slotLoad(columnSlot_t *slot)
+{
+    return *slot;
+}
+
+static int slotPublish(columnSlot_t *slot, float **column)
+{
+    *slot = *column;
+    return 1;
+}
+#endif
+
+struct csvLazyState {
+    char *data;                 //file contents, mapped when 'mapping' is not NULL
+    size_t size;
+    void *mapping;
+    csvIndex_t idx;
+    converter_t *convert;       //converter of every column, chosen when the file is opened
+    uint64_t buckets;           //number of buckets of CSV_HASHED columns
+    columnSlot_t *columns;      //converted columns, NULL until first asked for
+};
+
+/**
+ * @brief Open a '.csv' file for lazy loading: map and index it now, convert columns when first read.
+ *
+ * Opening runs the first phase of 'csvLoadIndexed()' only, so its cost is the structure scan. The
+ * mapping and the field index are kept, and 'csvColumn()' converts a column the first time it is
+ * asked for and caches it, so columns that are never read are never converted. Values are the
+ * same as those of 'csvLoadIndexed()'.
+ *
+ * Only 'opts->path', 'colTypes', 'hashCols' and 'hashBuckets' apply; other options are rejected.
+ *
+ * @param opts A pointer to the load options, or NULL to open CSV_PATH.
+ * @return A pointer to a dynamically allocated 'csvLazy_t', or NULL if an option is not supported, the
+ *         file could not be read or memory could not be allocated.
+ *
+ * @note The caller is responsible for releasing the lazy frame with 'csvCloseLazy()', which also
+ *       releases every column returned by 'csvColumn()'.
+ *
+ * @code
+ *   // Example usage:
+ *   csvLazy_t *lazy = csvOpenLazy(NULL);
+ *   if (lazy != NULL)
+ *   {
+ *       const float *label = csvColumn(lazy, 3); // only this column is converted
+ *       for (int row = 0; row < lazy->rows; row++)
+ *       {
+ *           // Use label[row]...
+ *       }
+ *       csvCloseLazy(lazy);
+ *   }
+ * @endcode
+ */
+csvLazy_t *csvOpenLazy(const csvLoadOpts_t *opts)
+{
+    csvLoadOpts_t none = {0};
+
+    if(opts == NULL)
+    {
+        opts = &none;
+    }
+
+    if(opts->nLookups > 0 || opts->dedupCapacity > 0 || opts->sketchK > 0 || opts->distinctCounts == TRUE ||
+       opts->sampleMode != CSV_SAMPLE_NONE)
+    {
+        puts("Option not supported by csvOpenLazy().");
+        return NULL;
+    }
+    for(int col=0; col<opts->nHashCols; col++)
+    {
+        if(opts->hashCols == NULL || opts->hashCols[col] < 0 || opts->hashBuckets <= 0)
+        {
+            puts("Invalid hashed columns.");
+            return NULL;
+        }
+    }
+
+    csvLazy_t *lazy = (csvLazy_t *)calloc(1, sizeof(csvLazy_t));
+    struct csvLazyState *state = (struct csvLazyState *)calloc(1, sizeof(struct csvLazyState));
+    if(lazy == NULL || state == NULL)
+    {
+        free(lazy);
+        free(state);
+        return NULL;
+    }
+    lazy->state = state;
+
+    if(readWhole(opts->path != NULL ? opts->path : CSV_PATH, &state->data, &state->size, &state->mapping) != TRUE)
+    {
+        free(state);
+        free(lazy);
+        return NULL;
+    }
+    if(indexBuild(&state->idx, state->data, state->size, lineAfter(state->data, state->size, 0), state->size,
+                  CSV_DELIM) != TRUE)
+    {
+        puts("Could not index the file.");
+        releaseWhole(state->data, state->size, state->mapping);
+        free(state);
+        free(lazy);
+        return NULL;
+    }
+    if(hashTypesValid(opts, state->idx.cols) != TRUE)
+    {
+        puts("Invalid hashed columns.");
+        indexFree(&state->idx);
+        releaseWhole(state->data, state->size, state->mapping);
+        free(state);
+        free(lazy);
+        return NULL;
+    }
+
+    state->buckets = (uint64_t)opts->hashBuckets;
+    state->convert = indexConverters(state->idx.cols, opts);
+    state->columns = (columnSlot_t *)calloc(state->idx.cols + 1, sizeof(columnSlot_t));
+    lazy->params = indexParams(state->data, state->size);
+    lazy->rows = state->idx.rows;
+    lazy->cols = state->idx.cols;
+
+    if(state->convert == NULL || state->columns == NULL || lazy->params == NULL)
+    {
+        csvCloseLazy(lazy);
+        return NULL;
+    }
+
+    return lazy;
+}
+
+/**
+ * @brief The values of one column of a lazy frame, converted on the first call and cached.
+ *
+ * Safe to call from several threads at once: the first caller of each column converts it, and two
+ * threads asking for the same unconverted column at the same moment may both convert it, the
+ * second result being discarded. Later calls return the cached column without converting again.
+ *
+ * @param lazy A lazy frame opened with 'csvOpenLazy()'.
+ * @param col The column to read.
+ * @return A pointer to 'lazy->rows' values, valid until 'csvCloseLazy()', or NULL if 'col' is out of
+ *         range or memory could not be allocated.
+ */
+const float *csvColumn(csvLazy_t *lazy, int col)
+{
+    if(lazy == NULL || col < 0 || col >= lazy->cols)
+    {
+        return NULL;
+    }
+
+    struct csvLazyState *state = lazy->state;
+    float *column = slotLoad(&state->columns[col]);
+    if(column != NULL) //converted before
+    {
+        return column;
+    }
+
+    convertCtx_t ctx = {state->buckets, 0};
+    column = (float *)malloc(sizeof(float) * ((size_t)lazy->rows + 1));
+    if(column == NULL || indexConvertColumn(&state->idx, col, state->convert[col], &ctx, column) != TRUE)
+    {
+        free(column);
+        return NULL;
+    }
+
+    float *mine = column;
+    if( ! slotPublish(&state->columns[col], &column)) //another thread published first
+    {
+        free(mine);
+    }
+
+    return column;
+}
+
+/**
+ * @brief Release a lazy frame, its mapping and its converted columns. Passing NULL is allowed.
+ */
+void csvCloseLazy(csvLazy_t *lazy)
+{
+    if(lazy == NULL)
+    {
+        return;
+    }
+
+    struct csvLazyState *state = lazy->state;
+    for(int col=0; state->columns != NULL && col<lazy->cols; col++)
+    {
+        free(slotLoad(&state->columns[col]));
+    }
+    free(state->columns);
+    free(state->convert);
+    indexFree(&state->idx);
+    releaseWhole(state->data, state->size, state->mapping);
+    free(state);
+    free(lazy->params);
+    free(lazy);
+}
+
+/**
+ * @brief Load the data lines picked by 'csvHead()', 'csvTail()' or 'csvRange()'.
+ *
+ * Only the lines asked for are indexed and converted. The file is mapped, so the pages before 'skip'
+ * are only scanned for line breaks and the pages after the range are never read; where mapping is not
+ * available the file is read whole first.
+ */
+static csvData_t *loadLines(const char *path, long skip, int n, int fromEnd)
+{
+    csvLoadOpts_t none = {0};
+    statsTimer_t timer = {0};
+    csvIndex_t idx;
+    char *data;
+    size_t size;
+    void *mapping;
+
+    if(path == NULL || skip < 0 || n < 0)
+    {
+        puts("Invalid row range.");
+        return NULL;
+    }
+    if(readWhole(path, &data, &size, &mapping) != TRUE)
+    {
+        return NULL;
+    }
+
+    size_t body = lineAfter(data, size, 0), from = body, to = size; //data lines start after the header
+    if(fromEnd)
+    {
+        from = size;
+        for(int taken=0; taken<n && from > body; taken++) //step back over one line
+        {
+            from--; //onto the line break, or the last byte, of the line before
+            while(from > body && data[from - 1] != '\n')
+            {
+                from--;
+            }
+        }
+    }
+    else
+    {
+        for(long skipped=0; skipped<skip && from < size; skipped++)
+        {
+            from = lineAfter(data, size, from);
+        }
+        to = from;
+        for(int taken=0; taken<n && to < size; taken++)
+        {
+            to = lineAfter(data, size, to);
+        }
+    }
+
+    if(indexBuild(&idx, data, size, from, to, CSV_DELIM) != TRUE)
+    {
+        puts("Could not index the file.");
+        releaseWhole(data, size, mapping);
+        return NULL;
+    }
+
+    convertCtx_t ctx = {1, 0};
+    csvData_t *df = indexedFrame(&idx, &none, &ctx, NULL, &timer);
+
+    indexFree(&idx);
+    releaseWhole(data, size, mapping);
+
+    return df;
+}
+
+/**
+ * @brief Load the first 'n' data rows of a '.csv' file, reading no further than they end.
+ *
+ * Meant for previews of large files: the cost depends on 'n', not on the size of the file. The
+ * frame has the columns of the first data row and the values 'loadCsvWith()' would give, see
+ * 'csvLoadIndexed()'.
+ *
+ * @param path The '.csv' file to read.
+ * @param n The number of rows wanted, fewer are returned if the file is shorter.
+ * @return A pointer to a dynamically allocated 'csvData_t' structure, or NULL if an argument is invalid,
+ *         the file could not be read or memory could not be allocated.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *preview = csvHead("../data/training_data.csv", 20);
+ *   if (preview != NULL)
+ *   {
+ *       // Show the first 20 rows...
+ *       freeDataFrame(preview);
+ *   }
+ * @endcode
+ */
+csvData_t *csvHead(const char *path, int n)
+{
+    return loadLines(path, 0, n, 0);
+}
+
+/**
+ * @brief Load the last 'n' data rows of a '.csv' file, scanning backwards from its end.
+ *
+ * Line breaks are searched for from the end of the file, so only the last rows, the header and the
+ * first data row, which sets the columns, are read. Lines are split at line breaks only, the rule every
+ * loader of this library follows since none of them is quote aware, so a field holding a line break
+ * splits its row here as it does everywhere else.
+ *
+ * @param path The '.csv' file to read.
+ * @param n The number of rows wanted, fewer are returned if the file is shorter.
+ * @return A pointer to a dynamically allocated 'csvData_t' structure, in file order, or NULL if an
+ *         argument is invalid, the file could not be read or memory could not be allocated.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ */
+csvData_t *csvTail(const char *path, int n)
+{
+    return loadLines(path, 0, n, 1);
+}
+
+/**
+ * @brief Load 'n' data rows of a '.csv' file after skipping its first 'skip' data rows.
+ *
+ * Skipped rows are only searched for line breaks, and reading stops at the end of the last row
+ * wanted, so paging through a large file costs the rows before and within each page.
+ *
+ * @param path The '.csv' file to read.
+ * @param skip The number of data rows skipped, the header is never counted.
+ * @param n The number of rows wanted, fewer are returned if the file is shorter.
+ * @return A pointer to a dynamically allocated 'csvData_t' structure, or NULL if an argument is invalid,
+ *         the file could not be read or memory could not be allocated.
+ *
+ * @note The caller is responsible for releasing the returned frame with 'freeDataFrame()'.
+ *
+ * @code
+ *   // Example usage:
+ *   csvData_t *page = csvRange("../data/training_data.csv", 1000, 50); // rows 1000 to 1049
+ *   if (page != NULL)
+ *   {
+ *       // Show the page...
+ *       freeDataFrame(page);
+ *   }
+ * @endcode
+ */
+csvData_t *csvRange(const char *path, long skip, int n)
+{
+    return loadLines(path, skip, n, 0);
 }
@@ -21,12 +21,61 @@
 #define DML_OPEN_CSV_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 #define CSV_PATH        ("../data/training_data.csv")
 #define CSV_MODE        ("r")
 #define CSV_DELIM       (", ")
+#define CSV_ZONE_ROWS   (65536)     //rows summarised by one zone map block
+#define CSV_HLL_BITS    (12)        //log2 of the number of HyperLogLog registers per column
+#define CSV_JOIN_PARTITION_ROWS (1 << 20)   //build side rows above which joins are radix partitioned
+#define CSV_STATS_SAMPLE (64)       //one record in this many is timed stage by stage, see csvStats_t
+#define CSV_TRACE_ROWS  (16384)     //records per traced block, see csvTracer_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 typedef enum {FALSE, TRUE, ERROR = -1} bool_t;
+typedef enum {CSV_ASCENDING, CSV_DESCENDING} csvOrder_t;
+typedef enum {CSV_FLOAT, CSV_INT, CSV_HASHED, CSV_SKIP} csvType_t;
+typedef enum {CSV_SAMPLE_NONE, CSV_SAMPLE_RESERVOIR, CSV_SAMPLE_BERNOULLI, CSV_SAMPLE_BLOCK} csvSample_t;
+typedef enum {CSV_SUM, CSV_COUNT, CSV_MEAN, CSV_MIN, CSV_MAX} csvAggOp_t;
+typedef enum {CSV_STAGE_IO, CSV_STAGE_SCAN, CSV_STAGE_CONVERT, CSV_STAGE_ALLOC, CSV_STAGES} csvStage_t;
+typedef enum {CSV_CYCLES, CSV_INSTRUCTIONS, CSV_BRANCH_MISSES, CSV_L1D_MISSES, CSV_LLC_MISSES, CSV_DTLB_MISSES,
+              CSV_COUNTERS} csvCounter_t;
+
+typedef struct {
+    int col;            //column to aggregate
+    csvAggOp_t op;      //aggregate function applied to the column within each group
+}csvAgg_t;
+
+typedef struct {
+    int blockRows;      //number of rows per block, the last block may be shorter
+    int blocks;         //number of blocks
+    int cols;           //number of columns summarised per block
+    float *min;         //per block minimum of every column, indexed as [block * cols + col]
+    float *max;         //per block maximum of every column, indexed as [block * cols + col]
+    int *nullCount;     //per block count of NaN values of every column, indexed as [block * cols + col]
+}csvZoneMap_t;
+
+typedef struct {
+    int rows;
+    int cols;
+    long nnz;           //number of stored entries
+    long *rowStart;     //rows + 1 offsets, row r holds the entries rowStart[r] to rowStart[r + 1] - 1
+    int *colIndex;      //column of every entry
+    float *values;      //value of every entry
+}csvSparse_t;
+
+typedef struct {
+    int k;              //number of values held per level, even
+    int levels;         //number of levels in use, a value on level h stands for 2^h input values
+    int *len;           //number of values held on each level
+    float **items;      //values held on each level
+    long n;             //number of values added, including merged sketches
+    uint64_t rng;       //state of the generator choosing which half of a level is promoted
+}csvSketch_t;
 
 typedef struct {
     char *delim;
@@ -35,14 +84,133 @@ typedef struct {
     char *params;
     long DFSize;
     float **dataFrame;
+    csvZoneMap_t *zoneMap;
+    float *block;       //contiguous storage of every row when not NULL, rows are then not freed one by one
+    csvSketch_t **sketches; //one quantile sketch per column when requested at load, NULL otherwise
+    unsigned char *hll; //HyperLogLog registers, 1 << CSV_HLL_BITS per column, when requested at load
+    const void *parent; //frame the rows are borrowed from when not NULL, see csvView()
+    void *mapping;      //file mapping the rows point into when not NULL, see csvLoadNpy()
+    size_t mappingSize;
 }csvData_t;
 
 
+typedef struct {                //filled by loads when the library is compiled with CSV_ENABLE_STATS
+    long long bytes;            //bytes of the file parsed, the sizing pass reads them once more
+    long records;               //data records read, kept or not
+    long long fields;           //fields tokenised
+    long fallbacks;             //CSV_FLOAT and CSV_INT fields handed to strtod() or strtoll()
+    size_t bytesHeld;           //bytes held by the loaded frame, quantile sketches excluded
+    size_t peakBytes;           //most bytes held by the load at once, quantile sketches excluded
+    double wall[CSV_STAGES];    //wall seconds spent per stage, extrapolated from the timed records
+    double cpu[CSV_STAGES];     //CPU seconds spent per stage, extrapolated from the timed records
+    double totalWall;           //wall seconds of the whole load
+    double totalCpu;            //CPU seconds of the whole load
+    long long counters[CSV_COUNTERS]; //hardware events of the whole load in user space, -1 when unavailable
+}csvStats_t;
+
+typedef struct {
+    const char *name;           //static string naming the span
+    double start;               //start in microseconds of a monotonic clock shared by all tracers
+    double duration;            //length in microseconds
+    long records;               //records covered by the span, -1 when not applicable
+    long long bytes;            //file bytes covered by the span, -1 when not applicable
+}csvTraceEvent_t;
+
+typedef struct {                //written by one thread only, give every thread its own tracer
+    csvTraceEvent_t *events;    //ring of the last 'capacity' spans
+    int capacity;
+    long long count;            //spans recorded, older ones are overwritten once the ring is full
+    int tid;                    //thread id shown in the trace viewer
+}csvTracer_t;
+
+typedef struct {                //opened with csvOpenLazy(), columns are converted when first read
+    int rows;
+    int cols;
+    char *params;
+    struct csvLazyState *state; //mapping, field index and converted columns, private to open_csv.c
+}csvLazy_t;
+
+typedef struct {
+    const csvData_t *table;     //lookup frame, usually small
+    int keyCol;                 //column of the loaded file matched against the lookup frame
+    int tableKeyCol;            //key column of the lookup frame
+}csvLookup_t;
+
+typedef struct {                //zero-initialise and set the fields of interest
+    const char *path;           //file to load, NULL loads CSV_PATH
+    const csvLookup_t *lookups; //lookup frames joined to every row while it is parsed, may be NULL
+    int nLookups;
+    int dedupCapacity;          //drop rows whose keys match one of the last 'dedupCapacity' kept rows, 0 disables
+    const int *dedupCols;       //file columns compared when dropping duplicates, NULL compares all of them
+    int nDedupCols;
+    int sketchK;                //feed every value into a per column quantile sketch with this level size, 0 disables
+    bool_t distinctCounts;      //estimate the number of distinct values of every column, see csvDistinctCount()
+    csvSample_t sampleMode;     //keep a random sample of the rows instead of all of them
+    int sampleRows;             //number of rows kept by CSV_SAMPLE_RESERVOIR
+    double sampleFraction;      //fraction of rows, or of blocks, kept by CSV_SAMPLE_BERNOULLI and CSV_SAMPLE_BLOCK
+    int sampleBlockRows;        //number of consecutive rows per block for CSV_SAMPLE_BLOCK
+    uint64_t seed;              //seed of the sampling generator
+    const int *hashCols;        //categorical file columns stored as the hash bucket of their raw bytes
+    int nHashCols;
+    int hashBuckets;            //number of hash buckets of the hashed columns, positive whenever one is hashed
+    const csvType_t *colTypes;  //type of every file column, NULL converts every column as CSV_FLOAT
+    csvStats_t *stats;          //receives the counters of the load, may be NULL
+    csvTracer_t *tracer;        //records the stages of the load as timed spans, may be NULL
+}csvLoadOpts_t;
+
+
 void closeFile(FILE *filePtr);
 int *getDFsize(FILE *filePtr);
 csvData_t *createDataFrame(FILE *filePtr);
 char *trimToken(char *token);
 csvData_t *loadCsv(FILE *filePtr);
+csvData_t *loadCsvWith(FILE *filePtr, const csvLoadOpts_t *opts);
+bool_t csvStatsToJson(const csvStats_t *stats, const char *label, FILE *out);
+csvTracer_t *csvTracerCreate(int capacity, int tid);
+void csvTracerFree(csvTracer_t *tracer);
+bool_t csvTraceDump(csvTracer_t *const *tracers, int nTracers, FILE *out);
+void freeDataFrame(csvData_t *df);
+bool_t csvBuildZoneMap(csvData_t *df, int blockRows);
+bool_t csvZoneMayMatch(const csvData_t *df, int block, int col, float lo, float hi);
+int *csvArgSort(const csvData_t *df, const int *cols, const csvOrder_t *order, int nKeys);
+bool_t csvSortBy(csvData_t *df, const int *cols, const csvOrder_t *order, int nKeys);
+csvData_t *csvGroupBy(const csvData_t *df, const int *keyCols, int nKeys, const csvAgg_t *aggs, int nAggs);
+int csvDedup(csvData_t *df, const int *cols, int nCols, unsigned char *dupMask);
+csvSketch_t *csvSketchCreate(int k);
+void csvSketchFree(csvSketch_t *sketch);
+bool_t csvSketchAdd(csvSketch_t *sketch, float value);
+bool_t csvSketchMerge(csvSketch_t *dst, const csvSketch_t *src);
+float csvSketchQuantile(const csvSketch_t *sketch, double q);
+float csvQuantile(const csvData_t *df, int col, double q);
+double csvDistinctCount(const csvData_t *df, int col);
+long *csvHistogram(const csvData_t *df, int col, int bins, float lo, float hi, const float *edges);
+csvData_t *csvView(const csvData_t *df, const int *rows, int n);
+int *csvKFold(const csvData_t *df, int labelCol, int k, uint64_t seed);
+bool_t csvTrainTestSplit(const csvData_t *df, int labelCol, double testFraction, uint64_t seed,
+                         int **train, int *nTrain, int **test, int *nTest);
+csvData_t *csvEncode(const csvData_t *df, int col, int buckets);
+csvSparse_t *csvEncodeSparse(const csvData_t *df, int col, int buckets);
+void csvFreeSparse(csvSparse_t *sparse);
+csvData_t *csvCovariance(const csvData_t *df, const int *cols, int nCols);
+csvData_t *csvCorrelation(const csvData_t *df, const int *cols, int nCols);
+bool_t csvCompact(csvData_t *df);
+float *csvToColumns(const csvData_t *df);
+csvData_t *csvFromColumns(const float *columns, int rows, int cols);
+bool_t csvTransposeInPlace(float *matrix, int n);
+bool_t csvSaveNpy(const csvData_t *df, const char *path);
+csvData_t *csvLoadNpy(const char *path);
+csvData_t *csvLoadIndexed(const csvLoadOpts_t *opts);
+csvLazy_t *csvOpenLazy(const csvLoadOpts_t *opts);
+const float *csvColumn(csvLazy_t *lazy, int col);
+void csvCloseLazy(csvLazy_t *lazy);
+csvData_t *csvHead(const char *path, int n);
+csvData_t *csvTail(const char *path, int n);
+csvData_t *csvRange(const char *path, long skip, int n);
+csvData_t *csvJoin(const csvData_t *left, const int *leftKeys, const csvData_t *right, const int *rightKeys, int nKeys);
+
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif //DML_OPEN_CSV_H
@@ -0,0 +1,380 @@
+/**
+ * Author(s):           Arda T. Kersu
+ * File name:           open_csv.hpp
+ * Date:                1st November 2023
+ *
+ * Description: Header-only C++17 wrapper around the library "open_csv.h". Frames are move-only objects
+ *              released automatically, rows and columns are exposed as views, and 'csv::reader' turns
+ *              every row into a typed tuple whose casts are generated at compile time from the
+ *              schema given as template arguments:
+ *
+ *                  csv::reader<int64_t, float, csv::skip, int> rows("training_data.csv");
+ *                  for (auto [id, value, label] : rows) { ... }
+ *
+ *              The C core stores every value as a float, so schema types are arithmetic types or
+ *              'csv::skip', and integers are exact only up to 2^24 (16777216) in magnitude; larger
+ *              ids come back rounded to the nearest float. Build with 'open_csv.c' compiled as C, see
+ *              the README.
+ *
+ * Disclaimer: This open-source project is provided "as is" without any warranty, expressed or implied.
+ *             The contributors and maintainers disclaim any an all unintended consequences or issues
+ *             that may arise from its use. Users are encouraged to review and understand the software's
+ *             characteristics before implementation.
+ *
+ *
+ * Copyright @ [Arda T. Kersu]
+ *
+ */
+
+#ifndef DML_OPEN_CSV_HPP
+#define DML_OPEN_CSV_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#include "open_csv.h"
+
+namespace csv {
+
+#if defined(__cpp_lib_span) && __cpp_lib_span >= 202002L
+template <class T>
+using span = std::span<T>;
+#else
+/**
+ * @brief Minimal stand-in for 'std::span' on C++17 standard libraries.
+ */
+template <class T>
+class span
+{
+public:
+    constexpr span() noexcept = default;
+    constexpr span(T *data, std::size_t size) noexcept : data_(data), size_(size) {}
+
+    constexpr T *data() const noexcept { return data_; }
+    constexpr std::size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T &operator[](std::size_t i) const noexcept { return data_[i]; }
+    constexpr T *begin() const noexcept { return data_; }
+    constexpr T *end() const noexcept { return data_ + size_; }
+
+private:
+    T *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+#endif
+
+/**
+ * @brief Schema placeholder for a column the reader drops.
+ */
+struct skip {};
+
+/**
+ * @brief One column of a frame, read through the row table without copying.
+ */
+class column_view
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = float;
+        using difference_type = std::ptrdiff_t;
+        using pointer = float *;
+        using reference = float &;
+
+        iterator(float *const *row, int col) noexcept : row_(row), col_(col) {}
+
+        float &operator*() const noexcept { return (*row_)[col_]; }
+        iterator &operator++() noexcept { ++row_; return *this; }
+        iterator operator++(int) noexcept { iterator old = *this; ++row_; return old; }
+        bool operator==(const iterator &other) const noexcept { return row_ == other.row_; }
+        bool operator!=(const iterator &other) const noexcept { return row_ != other.row_; }
+
+    private:
+        float *const *row_;
+        int col_;
+    };
+
+    column_view(float *const *rows, std::size_t size, int col) noexcept : rows_(rows), size_(size), col_(col) {}
+
+    std::size_t size() const noexcept { return size_; }
+    float &operator[](std::size_t row) const noexcept { return rows_[row][col_]; }
+    iterator begin() const noexcept { return iterator(rows_, col_); }
+    iterator end() const noexcept { return iterator(rows_ + size_, col_); }
+
+private:
+    float *const *rows_;
+    std::size_t size_;
+    int col_;
+};
+
+/**
+ * @brief Move-only owner of a 'csvData_t', released with 'freeDataFrame()' on destruction.
+ *
+ * Replaces the manual release of every frame returned by the C functions: wrap the pointer once and
+ * let the scope end. Iterating a frame yields one 'span<float>' per row.
+ */
+class frame
+{
+public:
+    frame() noexcept = default;
+    explicit frame(csvData_t *df) noexcept : df_(df) {}
+    ~frame() { freeDataFrame(df_); }
+
+    frame(const frame &) = delete;
+    frame &operator=(const frame &) = delete;
+    frame(frame &&other) noexcept : df_(std::exchange(other.df_, nullptr)) {}
+    frame &operator=(frame &&other) noexcept
+    {
+        if(this != &other)
+        {
+            freeDataFrame(df_);
+            df_ = std::exchange(other.df_, nullptr);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Load a '.csv' file with 'loadCsvWith()', throwing 'std::runtime_error' on failure.
+     */
+    static frame load(const std::string &path, csvLoadOpts_t opts = csvLoadOpts_t{})
+    {
+        opts.path = path.c_str();
+        csvData_t *df = loadCsvWith(nullptr, &opts);
+        if(df == nullptr)
+        {
+            throw std::runtime_error("open_csv: could not load '" + path + "'");
+        }
+        return frame(df);
+    }
+
+    csvData_t *get() const noexcept { return df_; }
+    csvData_t *release() noexcept { return std::exchange(df_, nullptr); }
+    explicit operator bool() const noexcept { return df_ != nullptr; }
+
+    std::size_t rows() const noexcept { return df_ != nullptr ? static_cast<std::size_t>(df_->rows) : 0; }
+    std::size_t cols() const noexcept { return df_ != nullptr ? static_cast<std::size_t>(df_->cols) : 0; }
+
+    span<float> row(std::size_t row) const noexcept { return span<float>(df_->dataFrame[row], cols()); }
+    span<float> operator[](std::size_t row) const noexcept { return this->row(row); }
+    column_view column(int col) const noexcept { return column_view(df_->dataFrame, rows(), col); }
+
+    /**
+     * @brief The whole frame as one row-major span, compacting it first, see 'csvCompact()'.
+     */
+    span<float> values()
+    {
+        if(csvCompact(df_) != TRUE)
+        {
+            throw std::runtime_error("open_csv: could not compact the frame");
+        }
+        return span<float>(df_->block, rows() * cols()); //compaction leaves the rows in block order
+    }
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = span<float>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = span<float>;
+
+        iterator(float *const *row, std::size_t cols) noexcept : row_(row), cols_(cols) {}
+
+        span<float> operator*() const noexcept { return span<float>(*row_, cols_); }
+        iterator &operator++() noexcept { ++row_; return *this; }
+        iterator operator++(int) noexcept { iterator old = *this; ++row_; return old; }
+        bool operator==(const iterator &other) const noexcept { return row_ == other.row_; }
+        bool operator!=(const iterator &other) const noexcept { return row_ != other.row_; }
+
+    private:
+        float *const *row_;
+        std::size_t cols_;
+    };
+
+    iterator begin() const noexcept { return iterator(df_ != nullptr ? df_->dataFrame : nullptr, cols()); }
+    iterator end() const noexcept { return iterator(df_ != nullptr ? df_->dataFrame + rows() : nullptr, cols()); }
+
+private:
+    csvData_t *df_ = nullptr;
+};
+
+namespace detail {
+
+template <class T>
+constexpr bool is_column_type = std::is_arithmetic_v<T> || std::is_same_v<T, skip>;
+
+/**
+ * @brief Loader type of a schema column: skipped columns are not parsed, integers are parsed as such.
+ */
+template <class T>
+constexpr csvType_t column_type()
+{
+    if constexpr(std::is_same_v<T, skip>)
+    {
+        return CSV_SKIP;
+    }
+    else if constexpr(std::is_integral_v<T> && ! std::is_same_v<T, bool>)
+    {
+        return CSV_INT;
+    }
+    else
+    {
+        return CSV_FLOAT;
+    }
+}
+
+/**
+ * @brief Convert the value of column 'Col' to 'T', as a one element tuple, or no element for 'skip'.
+ */
+template <class T, std::size_t Col>
+inline auto convert(const float *row)
+{
+    if constexpr(std::is_same_v<T, skip>)
+    {
+        (void)row;
+        return std::tuple<>();
+    }
+    else if constexpr(std::is_same_v<T, bool>)
+    {
+        return std::tuple<bool>(row[Col] != 0.0f);
+    }
+    else if constexpr(std::is_integral_v<T>)
+    {
+        return std::tuple<T>(static_cast<T>(std::llround(row[Col]))); //exact for CSV_INT columns, rounds frames parsed as floats
+    }
+    else
+    {
+        return std::tuple<T>(static_cast<T>(row[Col]));
+    }
+}
+
+template <class... Ts, std::size_t... Cols>
+inline auto convertRow(const float *row, std::index_sequence<Cols...>)
+{
+    return std::tuple_cat(convert<Ts, Cols>(row)...);
+}
+
+} //namespace detail
+
+/**
+ * @brief Typed row reader with a compile-time schema.
+ *
+ * Each template argument is the type of one file column, or 'skip' to drop it. Turning a stored row
+ * into a tuple is a fixed sequence of casts generated for the schema, with no per-field type dispatch
+ * at run time. Iterating yields 'value_type', a tuple of the non-skipped types, ready for structured
+ * bindings. The constructor throws 'std::runtime_error' if the file cannot be loaded or its number of
+ * columns differs from the schema; the count is checked on the first data row, before the file is
+ * parsed.
+ *
+ * Parsing the text itself is done by the C loader, which this wrapper does not replace: loading from
+ * a path hands the schema to it as 'csvLoadOpts_t.colTypes', unless the options already set them, and
+ * the loader picks one converter function per column before the first row and calls it through a
+ * table for every field. 'skip' columns are not parsed, and integer columns are read with CSV_INT,
+ * which truncates like 'strtol()' instead of going through a float parse. Values are still stored as
+ * floats, exact for integers up to 2^24 in magnitude.
+ */
+template <class... Ts>
+class reader
+{
+    static_assert(sizeof...(Ts) > 0, "csv::reader needs at least one column type");
+    static_assert((detail::is_column_type<Ts> && ...),
+                  "csv::reader columns must be arithmetic types or csv::skip, the C core stores floats");
+
+public:
+    using value_type = decltype(detail::convertRow<Ts...>(nullptr, std::index_sequence_for<Ts...>()));
+
+    explicit reader(const std::string &path, csvLoadOpts_t opts = csvLoadOpts_t{})
+        : frame_(load(path, opts))
+    {
+        check();
+    }
+
+    explicit reader(frame &&loaded) : frame_(std::move(loaded))
+    {
+        check();
+    }
+
+    std::size_t size() const noexcept { return frame_.rows(); }
+    value_type operator[](std::size_t row) const { return convert(frame_.get()->dataFrame[row]); }
+    const csv::frame &data() const noexcept { return frame_; }
+
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename reader::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        explicit iterator(float *const *row) noexcept : row_(row) {}
+
+        value_type operator*() const { return reader::convert(*row_); }
+        iterator &operator++() noexcept { ++row_; return *this; }
+        iterator operator++(int) noexcept { iterator old = *this; ++row_; return old; }
+        bool operator==(const iterator &other) const noexcept { return row_ == other.row_; }
+        bool operator!=(const iterator &other) const noexcept { return row_ != other.row_; }
+
+    private:
+        float *const *row_;
+    };
+
+    iterator begin() const noexcept { return iterator(frame_.get()->dataFrame); }
+    iterator end() const noexcept { return iterator(frame_.get()->dataFrame + frame_.rows()); }
+
+private:
+    static constexpr csvType_t types_[sizeof...(Ts)] = {detail::column_type<Ts>()...};
+
+    /**
+     * @brief Check the column count on the first data row, then load with the schema types; the loader
+     *        reads one type per file column, so the count must match before they are passed.
+     */
+    static frame load(const std::string &path, csvLoadOpts_t opts)
+    {
+        frame first(csvHead(path.c_str(), 1));
+        if( ! first)
+        {
+            throw std::runtime_error("open_csv: could not load '" + path + "'");
+        }
+        if(first.rows() > 0 && first.cols() != sizeof...(Ts)) //fail before the whole file is parsed
+        {
+            throw std::runtime_error("open_csv: the file does not have " + std::to_string(sizeof...(Ts)) + " columns");
+        }
+        if(opts.colTypes == nullptr && first.rows() > 0)
+        {
+            opts.colTypes = types_;
+        }
+        return frame::load(path, opts);
+    }
+
+    static value_type convert(const float *row)
+    {
+        return detail::convertRow<Ts...>(row, std::index_sequence_for<Ts...>());
+    }
+
+    void check() const
+    {
+        if( ! frame_ || frame_.cols() != sizeof...(Ts))
+        {
+            throw std::runtime_error("open_csv: the file does not have " + std::to_string(sizeof...(Ts)) + " columns");
+        }
+    }
+
+    csv::frame frame_;
+};
+
+} //namespace csv
+
+#endif //DML_OPEN_CSV_HPP
@@ -0,0 +1,283 @@
+/**
+ * Author(s):           Arda T. Kersu
+ * File name:           open_csv_module.c
+ * Date:                1st November 2023
+ *
+ * Description: CPython extension module exposing the loaders of the library "open_csv.h" to Python.
+ *              Loaded frames are handed to Python as 'open_csv.Frame' objects that share their memory
+ *              through the buffer protocol and '__array_interface__', so NumPy and pandas can wrap
+ *              them without a copy:
+ *
+ *                  import numpy as np, open_csv
+ *                  frame = open_csv.load("training_data.csv")
+ *                  data = np.asarray(frame)      # (rows, cols) float32, no copy
+ *                  label = data[:, 3]            # a column, still no copy
+ *
+ *              See the README for build instructions.
+ *
+ * Disclaimer: This open-source project is provided "as is" without any warranty, expressed or implied.
+ *             The contributors and maintainers disclaim any an all unintended consequences or issues
+ *             that may arise from its use. Users are encouraged to review and understand the software's
+ *             characteristics before implementation.
+ *
+ *
+ * Copyright @ [Arda T. Kersu]
+ *
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include "../open_csv.h"
+
+typedef struct {
+    PyObject_HEAD
+    csvData_t *df;      //compacted frame, rows are contiguous in 'df->block' or in a file mapping
+}frameObject_t;
+
+static const char *floatTypestr(void)
+{
+    const uint16_t probe = 1;
+
+    return *(const unsigned char *)&probe ? "<f4" : ">f4";
+}
+
+static float *frameData(const frameObject_t *self)
+{
+    return self->df->rows > 0 ? self->df->dataFrame[0] : (float *)self->df->block;
+}
+
+static void frameDealloc(frameObject_t *self)
+{
+    freeDataFrame(self->df);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/**
+ * @brief Export the frame as a 2-D float32 buffer of shape (rows, cols) in C order.
+ *
+ * Consumers that do not ask for PyBUF_ND get the same memory as one contiguous run of bytes, without
+ * shape, as the buffer protocol requires.
+ */
+static int frameGetBuffer(frameObject_t *self, Py_buffer *view, int flags)
+{
+    if(self->df == NULL)
+    {
+        PyErr_SetString(PyExc_BufferError, "frame is not loaded");
+        return -1;
+    }
+
+    int shaped = (flags & PyBUF_ND) == PyBUF_ND;
+    view->shape = NULL;
+    view->strides = NULL;
+    if(shaped)
+    {
+        view->shape = (Py_ssize_t *)PyMem_Malloc(sizeof(Py_ssize_t) * 4); //shape then strides
+        if(view->shape == NULL)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+        view->shape[0] = self->df->rows;
+        view->shape[1] = self->df->cols;
+        view->shape[2] = (Py_ssize_t)self->df->cols * (Py_ssize_t)sizeof(float);
+        view->shape[3] = sizeof(float);
+        view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? view->shape + 2 : NULL;
+    }
+
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+    view->buf = frameData(self);
+    view->itemsize = sizeof(float);
+    view->len = (Py_ssize_t)self->df->rows * self->df->cols * (Py_ssize_t)sizeof(float);
+    view->readonly = 0;
+    view->ndim = shaped ? 2 : 1;
+    view->format = (flags & PyBUF_FORMAT) ? "f" : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    return 0;
+}
+
+static void frameReleaseBuffer(frameObject_t *self, Py_buffer *view)
+{
+    (void)self;
+    PyMem_Free(view->shape);
+}
+
+static PyObject *frameGetRows(frameObject_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(self->df->rows);
+}
+
+static PyObject *frameGetCols(frameObject_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(self->df->cols);
+}
+
+/**
+ * @brief NumPy array interface, version 3, describing the same memory as the buffer.
+ */
+static PyObject *frameGetArrayInterface(frameObject_t *self, void *closure)
+{
+    (void)closure;
+    return Py_BuildValue("{s:(nn),s:s,s:(NO),s:O,s:i}",
+                         "shape", (Py_ssize_t)self->df->rows, (Py_ssize_t)self->df->cols,
+                         "typestr", floatTypestr(),
+                         "data", PyLong_FromVoidPtr(frameData(self)), Py_False,
+                         "strides", Py_None,
+                         "version", 3);
+}
+
+static PyGetSetDef frameGetSet[] = {
+    {"rows", (getter)frameGetRows, NULL, "number of rows", NULL},
+    {"cols", (getter)frameGetCols, NULL, "number of columns", NULL},
+    {"__array_interface__", (getter)frameGetArrayInterface, NULL, "NumPy array interface", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyBufferProcs frameBuffer = {
+    (getbufferproc)frameGetBuffer,
+    (releasebufferproc)frameReleaseBuffer
+};
+
+static PyTypeObject frameType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "open_csv.Frame",
+    .tp_basicsize = sizeof(frameObject_t),
+    .tp_dealloc = (destructor)frameDealloc,
+    .tp_as_buffer = &frameBuffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "A loaded data frame, shared with Python through the buffer protocol.",
+    .tp_getset = frameGetSet,
+};
+
+/**
+ * @brief Wrap a loaded frame, compacting it first so its rows are one contiguous matrix.
+ */
+static PyObject *wrapFrame(csvData_t *df)
+{
+    if(df == NULL)
+    {
+        PyErr_SetString(PyExc_OSError, "could not load the file");
+        return NULL;
+    }
+
+    frameObject_t *frame = PyObject_New(frameObject_t, &frameType);
+    if(frame == NULL)
+    {
+        freeDataFrame(df);
+        return NULL;
+    }
+    frame->df = df;
+
+    return (PyObject *)frame;
+}
+
+static PyObject *moduleLoad(PyObject *module, PyObject *args, PyObject *kwargs)
+{
+    static char *keywords[] = {"path", "sample_rows", "sample_fraction", "seed", NULL};
+    const char *path;
+    int sampleRows = 0;
+    double sampleFraction = 0.0;
+    unsigned long long seed = 0;
+    csvData_t *df;
+
+    (void)module;
+    if( ! PyArg_ParseTupleAndKeywords(args, kwargs, "s|idK", keywords, &path, &sampleRows, &sampleFraction, &seed))
+    {
+        return NULL;
+    }
+
+    csvLoadOpts_t opts = {0};
+    opts.path = path;
+    opts.seed = seed;
+    if(sampleRows > 0)
+    {
+        opts.sampleMode = CSV_SAMPLE_RESERVOIR;
+        opts.sampleRows = sampleRows;
+    }
+    else if(sampleFraction > 0.0)
+    {
+        opts.sampleMode = CSV_SAMPLE_BERNOULLI;
+        opts.sampleFraction = sampleFraction;
+    }
+
+    Py_BEGIN_ALLOW_THREADS //the loader touches no Python object
+    df = loadCsvWith(NULL, &opts);
+    if(df != NULL && csvCompact(df) != TRUE)
+    {
+        freeDataFrame(df);
+        df = NULL;
+    }
+    Py_END_ALLOW_THREADS
+
+    return wrapFrame(df);
+}
+
+static PyObject *moduleLoadNpy(PyObject *module, PyObject *args)
+{
+    const char *path;
+    csvData_t *df;
+
+    (void)module;
+    if( ! PyArg_ParseTuple(args, "s", &path))
+    {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    df = csvLoadNpy(path); //mapped frames are already contiguous
+    if(df != NULL && df->mapping == NULL && csvCompact(df) != TRUE)
+    {
+        freeDataFrame(df);
+        df = NULL;
+    }
+    Py_END_ALLOW_THREADS
+
+    return wrapFrame(df);
+}
+
+static PyMethodDef moduleMethods[] = {
+    {"load", (PyCFunction)(void (*)(void))moduleLoad, METH_VARARGS | METH_KEYWORDS,
+     "load(path, sample_rows=0, sample_fraction=0.0, seed=0) -> Frame\n\n"
+     "Load a '.csv' file. sample_rows keeps a reservoir sample of that many rows, sample_fraction a\n"
+     "Bernoulli sample. The GIL is released while the file is parsed."},
+    {"load_npy", moduleLoadNpy, METH_VARARGS,
+     "load_npy(path) -> Frame\n\nLoad a float '.npy' file, memory mapped when possible."},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef moduleDef = {
+    PyModuleDef_HEAD_INIT,
+    "open_csv",
+    "Zero-copy Python access to the open_csv loaders.",
+    -1,
+    moduleMethods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_open_csv(void)
+{
+    if(PyType_Ready(&frameType) < 0)
+    {
+        return NULL;
+    }
+
+    PyObject *module = PyModule_Create(&moduleDef);
+    if(module == NULL)
+    {
+        return NULL;
+    }
+
+    Py_INCREF(&frameType);
+    if(PyModule_AddObject(module, "Frame", (PyObject *)&frameType) < 0)
+    {
+        Py_DECREF(&frameType);
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    return module;
+}